@@ -0,0 +1,91 @@
+#include <caracal-config.h>
+#include <spdlog/cfg/helpers.h>
+#include <spdlog/fmt/ostr.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include <caracal/join.hpp>
+#include <caracal/utilities.hpp>
+#include <cxxopts.hpp>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using std::string;
+
+namespace {
+
+std::vector<fs::path> paths(const std::vector<string>& values) {
+  return {values.begin(), values.end()};
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::cerr << "caracal-join"
+            << " v" << CARACAL_VERSION << " (" << CARACAL_BUILD_TYPE
+            << " build)";
+  std::cerr << std::endl;
+
+  caracal::Join::Options join_options;
+  cxxopts::Options options("caracal-join");
+
+  // clang-format off
+  options.add_options()
+      ("h,help", "Show this message")
+      ("L,log-level", "Minimum log level (trace, debug, info, warning, error, fatal)", cxxopts::value<string>()->default_value("info"))
+      ("probes", "Probe logs written with --output-probes (comma-separated)", cxxopts::value<std::vector<string>>())
+      ("replies", "Replies written with --output-format binary (comma-separated)", cxxopts::value<std::vector<string>>())
+      ("output-probes", "Write the status and the RTT of each probe to this CSV file", cxxopts::value<string>())
+      ("temp-directory", "Directory of the temporary files", cxxopts::value<string>()->default_value(join_options.temp_directory.string()))
+      ("run-size", "Number of entries sorted in memory (40 bytes each) by each of the two sorts", cxxopts::value<size_t>()->default_value(std::to_string(join_options.run_size)));
+  // clang-format on
+
+  auto result = options.parse(argc, argv);
+
+  if (result.count("help") || !result.count("probes") ||
+      !result.count("replies")) {
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+
+  try {
+    join_options.temp_directory = result["temp-directory"].as<string>();
+    join_options.run_size = result["run-size"].as<size_t>();
+
+    spdlog::cfg::helpers::load_levels(result["log-level"].as<string>());
+    // See apps/caracal.cpp for why we need to create a dummy logger.
+    spdlog::set_default_logger(spdlog::stderr_color_st("dummy"));
+    spdlog::set_default_logger(spdlog::stderr_color_st(""));
+
+    std::optional<std::ofstream> probes_csv;
+    if (result.count("output-probes")) {
+      probes_csv.emplace(result["output-probes"].as<string>());
+      *probes_csv << caracal::Join::ProbeResult::csv_header() << "\n";
+    }
+
+    std::cout << caracal::Join::Destination::csv_header() << "\n";
+    const auto summary = caracal::Join::join(
+        paths(result["probes"].as<std::vector<string>>()),
+        paths(result["replies"].as<std::vector<string>>()), join_options,
+        [](const caracal::Join::Destination& destination) {
+          std::cout << destination.to_csv() << "\n";
+        },
+        [&](const caracal::Join::ProbeResult& probe) {
+          if (probes_csv) {
+            *probes_csv << probe.to_csv() << "\n";
+          }
+        });
+    spdlog::info(summary);
+  } catch (const std::exception& e) {
+    auto type = caracal::Utilities::demangle(typeid(e).name());
+    std::cerr << "Exception of type " << type << ": " << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -1,14 +1,26 @@
 #include <caracal-config.h>
 #include <spdlog/cfg/helpers.h>
+#include <spdlog/fmt/ostr.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
 
+#include <caracal/bitmap_sink.hpp>
+#include <caracal/checked.hpp>
 #include <caracal/prober.hpp>
 #include <caracal/prober_config.hpp>
+#include <caracal/prober_session.hpp>
+#include <caracal/protocols.hpp>
+#include <caracal/reparse.hpp>
+#include <caracal/statistics.hpp>
 #include <caracal/utilities.hpp>
 #include <cxxopts.hpp>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -34,14 +46,45 @@ int main(int argc, char** argv) {
       ("P,max-probes", "Maximum number of probes to send (unlimited by default)", cxxopts::value<int>())
       ("source-address-v4", "Specify the IPv4 source address to use in the packets (if probing in v4)", cxxopts::value<string>())
       ("source-address-v6", "Specify the IPv6 source address to use in the packets (if probing in v6)", cxxopts::value<string>())
+      ("source", "Send probes from this interface (interface[,ipv4][,ipv6]) instead of --interface and --source-address-v4/v6, can be repeated; the probes are spread across the sources by destination", cxxopts::value<std::vector<string>>())
       ("W,sniffer-wait-time", "Time in seconds to wait after sending the probes to stop the sniffer", cxxopts::value<int>()->default_value(std::to_string(config.sniffer_wait_time)))
+      ("drain-rtt-factor", "Stop waiting for replies once none has arrived for this many times the 99th percentile RTT (sniffer-wait-time remains the upper bound)", cxxopts::value<int>())
       ("rate-limiting-method", "Method to use to limit the packets rate (auto, active, sleep, none)", cxxopts::value<string>()->default_value(config.rate_limiting_method))
+      ("output-format", "Format of the replies written to stdout (csv, binary)", cxxopts::value<string>()->default_value(config.output_format))
+      ("output-shm", "Publish the replies into the named shared-memory ring (e.g. /caracal) instead of stdout", cxxopts::value<string>())
+      ("output-shm-capacity", "Number of records of the shared-memory ring (power of two)", cxxopts::value<int>())
+      ("output-pcap", "Write the raw captured frames to PREFIX-<interface>-<index>.pcap files", cxxopts::value<string>())
+      ("output-pcap-rotate-size", "Start a new capture file every N MB", cxxopts::value<int>())
+      ("output-pcap-rotate-interval", "Start a new capture file every N seconds", cxxopts::value<int>())
+      ("output-pcap-zstd", "Compress the capture files with zstd", cxxopts::value<bool>()->default_value("false"))
+      ("output-probes", "Append the probes sent, with their send time, to a binary file", cxxopts::value<string>())
+      ("reparse", "Instead of probing, parse the replies of pcap or pcapng files again (comma-separated, in capture order) and write them to stdout", cxxopts::value<std::vector<string>>())
+      ("dedup-fp-rate", "Do not send the same probe twice, using a Bloom filter with the specified false positive rate (e.g. 0.0001)", cxxopts::value<double>())
       ("filter-from-prefix-file-excl", "Do not send probes to prefixes specified in file (deny list)", cxxopts::value<string>())
       ("filter-from-prefix-file-incl", "Do not send probes to prefixes *not* specified in file (allow list)", cxxopts::value<string>())
       ("filter-min-ttl", "Do not send probes with ttl < min_ttl", cxxopts::value<int>())
       ("filter-max-ttl", "Do not send probes with ttl > max_ttl", cxxopts::value<int>())
       ("caracal-id", "Identifier encoded in the probes (random by default)", cxxopts::value<int>())
       ("meta-round", "Value of the round column in the CSV output", cxxopts::value<string>())
+      ("daemon", "Serve probe batches on the specified Unix socket instead of reading stdin", cxxopts::value<string>())
+      ("targets", "Instead of reading probes from stdin, probe every TTL of each address of the file (one per line) in a random (destination, TTL) order (Yarrp)", cxxopts::value<string>())
+      ("targets-min-ttl", "Minimum TTL of the probes generated from --targets", cxxopts::value<int>()->default_value("1"))
+      ("targets-max-ttl", "Maximum TTL of the probes generated from --targets", cxxopts::value<int>()->default_value("32"))
+      ("targets-protocol", "Protocol of the probes generated from --targets (icmp, udp)", cxxopts::value<string>()->default_value("icmp"))
+      ("ping-sweep", "Instead of reading probes from stdin, ping every address of the IPv4 prefixes of the file (one per line, e.g. 0.0.0.0/0) in a random order, and output a bitmap of the responders", cxxopts::value<string>())
+      ("ping-sweep-protocol", "Protocol of the ping sweep probes (icmp, udp)", cxxopts::value<string>()->default_value("icmp"))
+      ("output-bitmap", "File where the responders of the ping sweep are written (stdout by default)", cxxopts::value<string>())
+      ("sender-cpus", "Pin the send loop to these CPUs (e.g. 0-3,8)", cxxopts::value<string>())
+      ("sniffer-cpus", "Pin the sniffer threads to these CPUs", cxxopts::value<string>())
+      ("stats-cpus", "Pin the statistics thread to these CPUs", cxxopts::value<string>())
+      ("numa-local", "Pin the threads without a CPU list to the NUMA node of the interface, and allocate the capture and send buffers there", cxxopts::value<bool>()->default_value("false"))
+      ("realtime-priority", "Run the send loop and the sniffer threads with the SCHED_FIFO policy at this priority (1-99)", cxxopts::value<int>())
+      ("busy-poll", "Busy poll the device queue for up to this number of microseconds when waiting for replies", cxxopts::value<int>())
+      ("qdisc-bypass", "Send the probes directly to the device, bypassing the qdisc layer", cxxopts::value<bool>()->default_value("false"))
+      ("strict-filter", "Drop the foreign ICMP messages in the kernel, based on their destination, the quoted protocol and the caracal checksum", cxxopts::value<bool>()->default_value("false"))
+      ("tx-timestamps", "Read the time at which each probe was sent from the kernel (SO_TIMESTAMPING)", cxxopts::value<bool>()->default_value("false"))
+      ("stop-set", "Skip the probes below an interface already reached from another destination of the same prefix (Doubletree)", cxxopts::value<bool>()->default_value("false"))
+      ("prune-reached", "Skip the probes with a TTL higher than the one at which the destination replied", cxxopts::value<bool>()->default_value("false"))
       ("no-integrity-check", "Do not check that replies match valid probes", cxxopts::value<bool>()->default_value("false"));
   // clang-format on
 
@@ -69,6 +112,10 @@ int main(int argc, char** argv) {
       config.set_sniffer_wait_time(result["sniffer-wait-time"].as<int>());
     }
 
+    if (result.count("drain-rtt-factor")) {
+      config.set_drain_rtt_factor(result["drain-rtt-factor"].as<int>());
+    }
+
     if (result.count("source-address-v4")) {
       config.set_ip_version(4);
       config.set_source_ipv4(result["source-address"].as<std::string>());
@@ -79,6 +126,48 @@ int main(int argc, char** argv) {
       config.set_source_ipv6(result["source-address"].as<std::string>());
     }
 
+    if (result.count("sender-cpus")) {
+      config.set_sender_cpus(result["sender-cpus"].as<string>());
+    }
+
+    if (result.count("sniffer-cpus")) {
+      config.set_sniffer_cpus(result["sniffer-cpus"].as<string>());
+    }
+
+    if (result.count("stats-cpus")) {
+      config.set_stats_cpus(result["stats-cpus"].as<string>());
+    }
+
+    if (result.count("numa-local")) {
+      config.set_numa_local(true);
+    }
+
+    if (result.count("realtime-priority")) {
+      config.set_realtime_priority(result["realtime-priority"].as<int>());
+    }
+
+    if (result.count("busy-poll")) {
+      config.set_busy_poll(result["busy-poll"].as<int>());
+    }
+
+    if (result.count("qdisc-bypass")) {
+      config.set_qdisc_bypass(true);
+    }
+
+    if (result.count("strict-filter")) {
+      config.set_strict_filter(true);
+    }
+
+    if (result.count("tx-timestamps")) {
+      config.set_tx_timestamps(true);
+    }
+
+    if (result.count("source")) {
+      for (const auto& source : result["source"].as<std::vector<string>>()) {
+        config.add_source(source);
+      }
+    }
+
 
     if (result.count("max-probes")) {
       config.set_max_probes(result["max-probes"].as<int>());
@@ -93,6 +182,44 @@ int main(int argc, char** argv) {
           result["rate-limiting-method"].as<string>());
     }
 
+    if (result.count("output-format")) {
+      config.set_output_format(result["output-format"].as<string>());
+    }
+
+    if (result.count("output-shm")) {
+      config.set_output_shm(result["output-shm"].as<string>());
+    }
+
+    if (result.count("output-shm-capacity")) {
+      config.set_output_shm_capacity(result["output-shm-capacity"].as<int>());
+    }
+
+    if (result.count("output-pcap")) {
+      config.set_output_pcap(result["output-pcap"].as<string>());
+    }
+
+    if (result.count("output-pcap-rotate-size")) {
+      config.set_output_pcap_rotate_size(
+          result["output-pcap-rotate-size"].as<int>());
+    }
+
+    if (result.count("output-pcap-rotate-interval")) {
+      config.set_output_pcap_rotate_interval(
+          result["output-pcap-rotate-interval"].as<int>());
+    }
+
+    if (result.count("output-pcap-zstd")) {
+      config.set_output_pcap_zstd(true);
+    }
+
+    if (result.count("output-probes")) {
+      config.set_output_probes(result["output-probes"].as<string>());
+    }
+
+    if (result.count("dedup-fp-rate")) {
+      config.set_dedup_fp_rate(result["dedup-fp-rate"].as<double>());
+    }
+
     if (result.count("filter-from-prefix-file-excl")) {
       fs::path path{result["filter-from-prefix-file-excl"].as<string>()};
       config.set_prefix_excl_file(path);
@@ -119,6 +246,14 @@ int main(int argc, char** argv) {
       config.set_meta_round(result["meta-round"].as<string>());
     }
 
+    if (result.count("stop-set")) {
+      config.set_stop_set(true);
+    }
+
+    if (result.count("prune-reached")) {
+      config.set_prune_reached(true);
+    }
+
     if (result.count("no-integrity-check")) {
       config.set_integrity_check(false);
     }
@@ -130,8 +265,76 @@ int main(int argc, char** argv) {
     spdlog::set_default_logger(spdlog::stderr_color_st("dummy"));
     spdlog::set_default_logger(spdlog::stderr_color_st(""));
 
-    spdlog::info("Reading from stdin, press CTRL+D to stop...");
-    caracal::Prober::probe(config, std::cin);
+    if (result.count("reparse")) {
+      std::vector<fs::path> files;
+      for (const auto& file : result["reparse"].as<std::vector<string>>()) {
+        files.emplace_back(file);
+      }
+      caracal::Reparse::Options options;
+      options.caracal_id = config.caracal_id;
+      options.integrity_check = config.integrity_check;
+      options.meta_round = config.meta_round;
+      const auto statistics = caracal::Reparse::reparse(
+          files, std::cout, config.output_format, options);
+      spdlog::info(statistics);
+    } else if (result.count("daemon")) {
+      caracal::Prober::serve(config, result["daemon"].as<string>());
+    } else if (result.count("ping-sweep")) {
+      const auto protocol = caracal::Protocols::l4_from_string(
+          result["ping-sweep-protocol"].as<string>());
+      std::ifstream ifs{result["ping-sweep"].as<string>()};
+      std::vector<string> prefixes;
+      string line;
+      while (std::getline(ifs, line)) {
+        if (!line.empty() && !line.starts_with("#")) {
+          prefixes.push_back(line);
+        }
+      }
+      const uint64_t key = std::random_device{}();
+      spdlog::info("prefixes={} permutation_key={}", prefixes.size(), key);
+      auto it = caracal::Prober::sweep_iterator(prefixes, protocol, key);
+      auto bitmap = std::make_shared<caracal::BitmapSink>();
+      {
+        caracal::Prober::Session session{config, bitmap};
+        session.run(it, config.meta_round);
+      }
+      spdlog::info("responders={}", bitmap->count());
+      if (result.count("output-bitmap")) {
+        std::ofstream ofs{result["output-bitmap"].as<string>(),
+                          std::ios::binary};
+        bitmap->dump(ofs);
+      } else {
+        bitmap->dump(std::cout);
+      }
+    } else if (result.count("targets")) {
+      using caracal::Checked::numeric_cast;
+      const auto min_ttl =
+          numeric_cast<uint8_t>(result["targets-min-ttl"].as<int>());
+      const auto max_ttl =
+          numeric_cast<uint8_t>(result["targets-max-ttl"].as<int>());
+      const auto protocol = caracal::Protocols::l4_from_string(
+          result["targets-protocol"].as<string>());
+      std::ifstream ifs{result["targets"].as<string>()};
+      std::vector<in6_addr> destinations;
+      string line;
+      while (std::getline(ifs, line)) {
+        in6_addr addr{};
+        try {
+          caracal::Utilities::parse_addr(line, addr);
+          destinations.push_back(addr);
+        } catch (const std::exception& e) {
+          spdlog::warn("line={} error={}", line, e.what());
+        }
+      }
+      const uint64_t key = std::random_device{}();
+      spdlog::info("targets={} permutation_key={}", destinations.size(), key);
+      auto it = caracal::Prober::random_iterator(
+          std::move(destinations), min_ttl, max_ttl, protocol, key);
+      caracal::Prober::probe(config, it);
+    } else {
+      spdlog::info("Reading from stdin, press CTRL+D to stop...");
+      caracal::Prober::probe(config, std::cin);
+    }
   } catch (const std::exception& e) {
     auto type = caracal::Utilities::demangle(typeid(e).name());
     std::cerr << "Exception of type " << type << ": " << e.what() << std::endl;
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <pthread.h>
+
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace caracal::Affinity {
+
+/// Parse a CPU list in the kernel format (e.g. `0-3,8,10-11`).
+[[nodiscard]] std::vector<int> parse_cpu_list(const std::string& s);
+
+/// Format a CPU list as a comma-separated list of CPUs.
+[[nodiscard]] std::string format_cpu_list(const std::vector<int>& cpus);
+
+/// CPUs of the NUMA node of the interface's device, from sysfs.
+/// Empty if unknown (virtual interfaces, non-NUMA hosts, non-Linux).
+[[nodiscard]] std::vector<int> numa_node_cpus(const std::string& interface);
+
+/// Pin a thread to `cpus` (if not empty), and run it with the SCHED_FIFO
+/// policy at `realtime_priority` (if set).
+/// Only implemented on Linux, does nothing elsewhere.
+/// @param name the role of the thread, for the logs.
+void set_thread_placement(pthread_t thread, const std::string& name,
+                          const std::vector<int>& cpus,
+                          std::optional<int> realtime_priority);
+
+/// Place a thread as in set_thread_placement, and restore its previous CPUs
+/// and scheduling policy on destruction (or if the placement fails).
+class ScopedThreadPlacement {
+ public:
+  ScopedThreadPlacement(pthread_t thread, const std::string& name,
+                        const std::vector<int>& cpus,
+                        std::optional<int> realtime_priority);
+
+  ~ScopedThreadPlacement();
+
+  ScopedThreadPlacement(const ScopedThreadPlacement&) = delete;
+  ScopedThreadPlacement& operator=(const ScopedThreadPlacement&) = delete;
+
+ private:
+  /// Restore the previous CPUs and policy, logging the errors.
+  void restore() noexcept;
+
+  pthread_t thread_;
+  std::string name_;
+  /// The previous CPUs, if they were changed.
+  std::optional<std::vector<int>> cpus_;
+  /// The previous policy and priority, if they were changed.
+  std::optional<std::pair<int, int>> policy_;
+};
+
+}  // namespace caracal::Affinity
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "./reply.hpp"
+#include "./reply_sink.hpp"
+
+namespace caracal {
+
+/// Record the IPv4 addresses that answered a ping sweep in a bitmap of the
+/// IPv4 space (512 MB of virtual memory, only the pages that contain
+/// responders are backed by physical memory).
+/// A responder is a destination that sent an echo reply or a destination
+/// unreachable message (e.g. port unreachable for UDP probes) itself.
+class BitmapSink : public ReplySink {
+ public:
+  BitmapSink();
+
+  ~BitmapSink() override;
+
+  BitmapSink(const BitmapSink &) = delete;
+  BitmapSink &operator=(const BitmapSink &) = delete;
+
+  void write(const Reply &reply, const std::string &round) override;
+
+  /// @param addr an IPv4 address (host order).
+  [[nodiscard]] bool contains(uint32_t addr) const noexcept;
+
+  /// Number of distinct responders.
+  [[nodiscard]] uint64_t count() const noexcept;
+
+  /// Write the responders as runs of consecutive addresses: each run is
+  /// the first and the last address (inclusive) of the run, as two 32-bit
+  /// integers in network order.
+  void dump(std::ostream &os) const;
+
+  static constexpr uint64_t size = uint64_t{1} << 32;
+
+ private:
+  uint64_t *words_;
+  uint64_t count_;
+};
+
+}  // namespace caracal
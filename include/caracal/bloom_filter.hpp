@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace caracal {
+
+/// A concurrent blocked Bloom filter.
+/// Each key sets `hashes` bits in the 8 words of a single 64-byte block (one
+/// bit per word, and a second one in some words above 8), so that an
+/// insertion or a lookup touches only one cache line.
+/// Insertions and lookups can be performed concurrently from any thread.
+class BloomFilter {
+ public:
+  /// @param size_log2 the size of the filter, in bits (log2), >= 9.
+  /// @param hashes the number of bits set per key, in [1, 16].
+  explicit BloomFilter(uint64_t size_log2, uint64_t hashes = 8);
+
+  /// Insert a (well-mixed) 64-bit hash.
+  /// @return false if the hash was (probably) already present.
+  bool insert(uint64_t hash) noexcept;
+
+  /// @return true if the hash is (probably) present.
+  [[nodiscard]] bool contains(uint64_t hash) const noexcept;
+
+  /// Remove all the hashes, must not be called concurrently with insert.
+  void clear() noexcept;
+
+  /// Size of the filter in bits.
+  [[nodiscard]] uint64_t size() const noexcept;
+
+ private:
+  static constexpr uint64_t block_words = 8;
+
+  [[nodiscard]] uint64_t block_index(uint64_t hash) const noexcept;
+
+  /// The bits of the hash in a word of its block.
+  /// @param extra the second hash, used above 8 hashes.
+  [[nodiscard]] uint64_t word_mask(uint64_t hash, uint64_t extra,
+                                   uint64_t word) const noexcept;
+
+  uint64_t blocks_log2_;
+  uint64_t hashes_;
+  std::unique_ptr<std::atomic<uint64_t>[]> words_;
+};
+
+/// A scalable Bloom filter: a chain of blocked Bloom filters of increasing
+/// size and decreasing false positive rate, so that the overall false
+/// positive rate stays below the target for any number of insertions.
+/// The number of hashes of each filter increases with its precision.
+/// See "Scalable Bloom Filters", Almeida et al., 2007.
+/// This class is not thread-safe.
+class ScalableBloomFilter {
+ public:
+  /// @param fp_rate the target false positive rate, in ]0, 1[.
+  /// @param initial_size_log2 the size of the first filter, in bits (log2).
+  explicit ScalableBloomFilter(double fp_rate, uint64_t initial_size_log2 = 20);
+
+  /// Insert a (well-mixed) 64-bit hash.
+  /// @return false if the hash was (probably) already present.
+  bool insert(uint64_t hash);
+
+  /// Number of filters in the chain.
+  [[nodiscard]] uint64_t filters() const noexcept;
+
+  /// Total size of the filters, in bits.
+  [[nodiscard]] uint64_t size() const noexcept;
+
+ private:
+  void grow();
+
+  struct Stage {
+    BloomFilter filter;
+    uint64_t hashes;
+    uint64_t capacity;
+    uint64_t count;
+  };
+
+  double fp_rate_;
+  uint64_t next_size_log2_;
+  std::vector<Stage> stages_;
+};
+
+/// Mix a 64-bit value (splitmix64 finalizer).
+[[nodiscard]] constexpr uint64_t mix64(uint64_t x) noexcept {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+}  // namespace caracal
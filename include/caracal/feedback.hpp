@@ -0,0 +1,93 @@
+#pragma once
+
+#include <netinet/in.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "./bloom_filter.hpp"
+#include "./probe.hpp"
+#include "./reply.hpp"
+
+namespace caracal {
+
+/// A lossy, fixed-size, concurrent table of per-destination TTLs.
+/// Each entry is tagged with 16 bits of the destination hash: on collision,
+/// the most recent destination replaces the previous one.
+class DestinationTable {
+ public:
+  /// @param size_log2 the number of entries (log2).
+  explicit DestinationTable(uint64_t size_log2);
+
+  /// Raise the TTL below which the probes towards `addr` are stopped.
+  void raise_stop_ttl(const in6_addr &addr, uint8_t ttl) noexcept;
+
+  /// @return the TTL below which the probes towards `addr` are stopped.
+  [[nodiscard]] uint8_t stop_ttl(const in6_addr &addr) const noexcept;
+
+  /// Lower the TTL at which `addr` replied.
+  void lower_reached_ttl(const in6_addr &addr, uint8_t ttl) noexcept;
+
+  /// @return the lowest TTL at which `addr` replied, or 0.
+  [[nodiscard]] uint8_t reached_ttl(const in6_addr &addr) const noexcept;
+
+ private:
+  // Entry layout: [tag:16][reached_ttl:8][stop_ttl:8]
+  static constexpr uint32_t stop_shift = 0;
+  static constexpr uint32_t reached_shift = 8;
+
+  /// Set the field at `shift` to `ttl` if `replace(current, ttl)`.
+  template <typename F>
+  void update(const in6_addr &addr, uint32_t shift, uint8_t ttl,
+              F replace) noexcept;
+
+  [[nodiscard]] uint8_t get(const in6_addr &addr, uint32_t shift)
+      const noexcept;
+
+  uint64_t mask_;
+  std::unique_ptr<std::atomic<uint32_t>[]> entries_;
+};
+
+/// Feedback from the sniffer to the probe source.
+/// The sniffer calls observe() for each valid reply, and the probe source
+/// calls the predicates below before sending a probe.
+///
+/// Stop set (see Doubletree, Donnet et al., 2005): the (interface,
+/// destination prefix) pairs observed so far. When a reply towards a
+/// destination comes from an interface already observed for another
+/// destination of the same prefix, the path below is assumed to be known and
+/// the probes with a lower TTL towards this destination are skipped.
+/// This is effective when the probes of each destination are sent by
+/// decreasing TTL, and interleaved with the probes of other destinations.
+///
+/// Destination reached: the lowest TTL at which each destination replied
+/// with an echo reply or a destination unreachable message. The probes
+/// with a higher TTL towards this destination are useless. This is
+/// effective when the probes are sent by increasing TTL.
+class Feedback {
+ public:
+  /// @param stop_set_size_log2 the size of the stop set, in bits (log2).
+  /// @param table_size_log2 the number of destinations tracked (log2).
+  explicit Feedback(uint64_t stop_set_size_log2 = 28,
+                    uint64_t table_size_log2 = 22);
+
+  /// Update the feedback state from a (valid) reply.
+  void observe(const Reply &reply) noexcept;
+
+  /// @return true if the probe is below a known interface of the stop set.
+  [[nodiscard]] bool stopped(const Probe &probe) const noexcept;
+
+  /// @return true if the destination was reached at a lower TTL.
+  [[nodiscard]] bool reached(const Probe &probe) const noexcept;
+
+  /// Length of the destination prefixes of the stop set.
+  static constexpr uint8_t prefix_length_v4 = 24;
+  static constexpr uint8_t prefix_length_v6 = 48;
+
+ private:
+  BloomFilter stop_set_;
+  DestinationTable destinations_;
+};
+
+}  // namespace caracal
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <netinet/in.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "./probe_log.hpp"
+#include "./reply.hpp"
+
+namespace fs = std::filesystem;
+
+/// Join the probes sent (see ProbeLog) with the replies received, offline,
+/// to get the status and the RTT of each probe.
+namespace caracal::Join {
+
+/// A probe or a reply, reduced to the fields of the join.
+struct Entry {
+  in6_addr dst_addr;  ///< Destination of the probe.
+  uint8_t protocol;   ///< IP protocol number of the probe.
+  uint8_t ttl;        ///< TTL of the probe.
+  uint16_t src_port;  ///< Source port of the probe.
+  uint16_t dst_port;  ///< Destination port of the probe, 0 for ICMP probes
+                      ///< (it is not encoded in the probes).
+  /// Send time of a probe or capture time of a reply, since the epoch.
+  std::chrono::nanoseconds timestamp;
+  /// Sequence number of a probe, 0 for a reply.
+  uint64_t sequence;
+
+  [[nodiscard]] static Entry from_probe(const ProbeLog::Record &record);
+
+  [[nodiscard]] static Entry from_reply(const Reply &reply) noexcept;
+
+  /// Whether the two entries refer to the same probe (destination, flow and
+  /// TTL), regardless of the time.
+  [[nodiscard]] bool same_probe(const Entry &other) const noexcept;
+
+  /// Order by destination, flow and TTL, then by time.
+  [[nodiscard]] bool operator<(const Entry &other) const noexcept;
+};
+
+/// Sort more entries than fit in memory: the sorted runs of `run_size`
+/// entries are written to temporary files, and merged when read.
+class ExternalSorter {
+ public:
+  /// @param directory where the temporary files are written.
+  ExternalSorter(const fs::path &directory, size_t run_size);
+
+  /// Remove the temporary files.
+  ~ExternalSorter();
+
+  ExternalSorter(const ExternalSorter &) = delete;
+  ExternalSorter &operator=(const ExternalSorter &) = delete;
+
+  void push(const Entry &entry);
+
+  /// Sort the last run, the entries can then be read with `next`.
+  void finish();
+
+  /// Read the next entry in order.
+  /// @return false once all the entries have been read.
+  bool next(Entry &entry);
+
+  /// Number of runs written to disk.
+  [[nodiscard]] size_t runs() const noexcept;
+
+ private:
+  class Run;
+
+  void write_run();
+
+  fs::path directory_;
+  /// Random prefix of the temporary files.
+  uint64_t id_;
+  size_t run_size_;
+  std::vector<Entry> entries_;
+  size_t cursor_;
+  std::vector<std::unique_ptr<Run>> runs_;
+  /// Indices of the runs, ordered as a min-heap of their current entry.
+  std::vector<size_t> heap_;
+};
+
+struct Options {
+  /// Where the temporary files of the sorts are written.
+  fs::path temp_directory = fs::temp_directory_path();
+  /// Number of entries sorted in memory by each of the two sorts (probes and
+  /// replies), 40 bytes each.
+  size_t run_size = size_t{1} << 24;
+};
+
+/// The result of a probe.
+struct ProbeResult {
+  Entry probe;
+  /// Number of replies matched to this probe (including the duplicates).
+  uint64_t replies = 0;
+  /// Time between the send and the capture of the first reply.
+  std::optional<std::chrono::nanoseconds> rtt;
+
+  [[nodiscard]] static std::string csv_header();
+  [[nodiscard]] std::string to_csv() const;
+};
+
+/// The results of the probes towards a destination.
+struct Destination {
+  in6_addr dst_addr{};
+  uint64_t probes = 0;
+  /// Number of probes with at least one reply.
+  uint64_t answered = 0;
+  /// Number of replies, including the duplicates.
+  uint64_t replies = 0;
+  std::chrono::nanoseconds rtt_min = std::chrono::nanoseconds::max();
+  std::chrono::nanoseconds rtt_max{0};
+  std::chrono::nanoseconds rtt_sum{0};
+
+  void add(const ProbeResult &result) noexcept;
+
+  /// Fraction of the probes without reply.
+  [[nodiscard]] double loss() const noexcept;
+
+  [[nodiscard]] static std::string csv_header();
+  /// The RTTs are in microseconds, and empty if no probe was answered.
+  [[nodiscard]] std::string to_csv() const;
+};
+
+struct Summary {
+  uint64_t probes = 0;
+  uint64_t answered = 0;
+  uint64_t replies = 0;
+  /// Number of replies which do not match any probe of the log (e.g. the
+  /// probes dropped from the log, or the replies to another measurement).
+  uint64_t unmatched_replies = 0;
+};
+
+std::ostream &operator<<(std::ostream &os, Summary const &v);
+
+/// Join the probe logs with the binary reply files (see
+/// Prober::Config::set_output_format), in bounded memory.
+/// A reply matches the last probe sent to the same destination, with the
+/// same flow and TTL, before its capture (or the first one if it was
+/// captured before all of them, e.g. because of clock skew).
+/// @param on_destination called for each destination, in address order.
+/// @param on_probe if set, called for each probe, in the same order.
+/// @throw std::system_error if a file cannot be opened.
+Summary join(const std::vector<fs::path> &probe_logs,
+             const std::vector<fs::path> &reply_files, const Options &options,
+             const std::function<void(const Destination &)> &on_destination,
+             const std::function<void(const ProbeResult &)> &on_probe = {});
+
+}  // namespace caracal::Join
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <netinet/in.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "./probe.hpp"
+#include "./prober_session.hpp"
+#include "./protocols.hpp"
+#include "./reply.hpp"
+#include "./reply_sink.hpp"
+#include "./statistics.hpp"
+
+/// Multipath Detection Algorithm (MDA).
+/// See "Failure Control in Multipath Route Tracing", Veitch et al., 2009.
+namespace caracal::MDA {
+
+/// Number of flows to send at a hop where `n_interfaces` interfaces have
+/// been discovered, to reject the hypothesis that there is one more
+/// interface with a probability of failure `epsilon`.
+/// Hops without replies are treated as hops with a single interface.
+[[nodiscard]] uint64_t stopping_point(uint64_t n_interfaces, double epsilon);
+
+/// An in-memory MDA engine: it receives the replies as a sink of a
+/// Prober::Session and computes the probes of the next round from the
+/// per-(destination, TTL) flow counters.
+/// Flows are identified by the source port of the probe, starting at
+/// `src_port`.
+class Engine : public ReplySink {
+ public:
+  /// @param destinations the destinations to trace.
+  /// @param min_ttl, max_ttl the range of TTLs to probe.
+  /// @param protocol the protocol of the probes.
+  /// @param epsilon the probability of failure at each hop.
+  /// @param next an optional sink to forward the replies to.
+  Engine(const std::vector<in6_addr> &destinations, uint8_t min_ttl,
+         uint8_t max_ttl, Protocols::L4 protocol, double epsilon = 0.05,
+         std::shared_ptr<ReplySink> next = nullptr);
+
+  void write(const Reply &reply, const std::string &round) override;
+
+  void flush() override;
+
+  /// Compute the probes of the next round, and count them as sent.
+  /// @return an empty vector once the algorithm has converged.
+  [[nodiscard]] std::vector<Probe> next_round();
+
+  /// Number of flows sent to `destination` at `ttl`.
+  [[nodiscard]] uint64_t flows(const in6_addr &destination, uint8_t ttl) const;
+
+  /// Interfaces discovered towards `destination` at `ttl`.
+  [[nodiscard]] std::vector<in6_addr> interfaces(const in6_addr &destination,
+                                                 uint8_t ttl) const;
+
+  static constexpr uint16_t src_port = 24000;
+  static constexpr uint16_t dst_port = 33434;
+  static constexpr uint64_t max_flows = UINT16_MAX - src_port;
+
+ private:
+  struct Interface {
+    in6_addr addr;
+    uint8_t ttl;
+  };
+
+  struct Destination {
+    in6_addr addr;
+    /// Lowest TTL at which the destination replied, 0 if never.
+    uint8_t reached_ttl;
+    /// Number of flows sent at each TTL, starting at min_ttl.
+    std::vector<uint16_t> flows;
+    /// Distinct (interface, TTL) pairs.
+    std::vector<Interface> interfaces;
+  };
+
+  [[nodiscard]] const Destination *find(const in6_addr &addr) const;
+
+  uint8_t min_ttl_;
+  uint8_t max_ttl_;
+  Protocols::L4 protocol_;
+  std::vector<uint16_t> stopping_points_;
+  std::shared_ptr<ReplySink> next_;
+  std::vector<Destination> destinations_;
+  std::unordered_map<in6_addr, size_t, Statistics::in6_addr_hash,
+                     Statistics::in6_addr_equal_to>
+      index_;
+  mutable std::mutex mutex_;
+};
+
+/// Run rounds of `engine` on `session` until convergence, or until
+/// `max_rounds` rounds have been sent. The replies are sent to `engine`, and
+/// the previous sink of the session is restored on return.
+/// @return the number of rounds sent.
+uint64_t run(Prober::Session &session, const std::shared_ptr<Engine> &engine,
+             uint64_t max_rounds);
+
+}  // namespace caracal::MDA
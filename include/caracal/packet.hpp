@@ -1,9 +1,66 @@
 #pragma once
 
+#include <net/ethernet.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/ip6.h>
+#include <netinet/udp.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "./constants.hpp"
 #include "./protocols.hpp"
 
 namespace caracal {
 
+/// Padding before the L2 header, to align the L3 header on a four-byte
+/// boundary. See https://lwn.net/Articles/89597/.
+constexpr size_t padding_size(const Protocols::L2 l2) noexcept {
+  return l2 == Protocols::L2::Ethernet ? 2 : 0;
+}
+
+constexpr size_t header_size(const Protocols::L2 l2) noexcept {
+  switch (l2) {
+    case Protocols::L2::BSDLoopback:
+      return sizeof(uint32_t);
+    case Protocols::L2::Ethernet:
+      return sizeof(ether_header);
+    case Protocols::L2::None:
+      return 0;
+  }
+  return 0;
+}
+
+constexpr size_t header_size(const Protocols::L3 l3) noexcept {
+  return l3 == Protocols::L3::IPv4 ? sizeof(ip) : sizeof(ip6_hdr);
+}
+
+constexpr size_t header_size(const Protocols::L4 l4) noexcept {
+  switch (l4) {
+    case Protocols::L4::ICMP:
+      return ICMP_HEADER_SIZE;
+    case Protocols::L4::ICMPv6:
+      return ICMPV6_HEADER_SIZE;
+    case Protocols::L4::UDP:
+      return sizeof(udphdr);
+  }
+  return 0;
+}
+
+/// The offsets of the layers of a packet, known at compile time, from the
+/// beginning of the buffer.
+template <Protocols::L2 L2, Protocols::L3 L3, Protocols::L4 L4>
+struct Layout {
+  static constexpr Protocols::L2 l2_protocol = L2;
+  static constexpr Protocols::L3 l3_protocol = L3;
+  static constexpr Protocols::L4 l4_protocol = L4;
+  static constexpr size_t l2_offset = padding_size(L2);
+  static constexpr size_t l3_offset = l2_offset + header_size(L2);
+  static constexpr size_t l4_offset = l3_offset + header_size(L3);
+  static constexpr size_t payload_offset = l4_offset + header_size(L4);
+};
+
 /// A structure holding pointers to the different layers of a packet buffer.
 class Packet {
  public:
@@ -11,6 +68,22 @@ class Packet {
          Protocols::L3 l3_protocol, Protocols::L4 l4_protocol,
          size_t payload_size);
 
+  /// Same as above, without computing the offsets at runtime.
+  template <Protocols::L2 L2, Protocols::L3 L3, Protocols::L4 L4>
+  Packet(std::byte *buffer, const size_t buffer_len, Layout<L2, L3, L4>,
+         const size_t payload_size)
+      : begin_{buffer},
+        end_{buffer + Layout<L2, L3, L4>::payload_offset + payload_size},
+        l2_{buffer + Layout<L2, L3, L4>::l2_offset},
+        l3_{buffer + Layout<L2, L3, L4>::l3_offset},
+        l4_{buffer + Layout<L2, L3, L4>::l4_offset},
+        payload_{buffer + Layout<L2, L3, L4>::payload_offset},
+        l2_protocol_{L2},
+        l3_protocol_{L3},
+        l4_protocol_{L4} {
+    check_size(buffer_len);
+  }
+
   /// A pointer to the first byte of the packet (may include padding bytes).
   [[nodiscard]] std::byte *begin() const noexcept;
 
@@ -51,6 +124,9 @@ class Packet {
   [[nodiscard]] Protocols::L4 l4_protocol() const noexcept;
 
  private:
+  /// @throw std::invalid_argument if the packet does not fit in the buffer.
+  void check_size(size_t buffer_len) const;
+
   std::byte *begin_;
   std::byte *end_;
   std::byte *l2_;
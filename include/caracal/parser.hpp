@@ -1,8 +1,12 @@
 #pragma once
 
+#include <pcap.h>
+
 #include <chrono>
+#include <cstddef>
 #include <optional>
 
+#include "./probe.hpp"
 #include "./reply.hpp"
 
 /// Parse traceroute replies.
@@ -59,4 +63,18 @@ template <typename T>
 /// @return the parsed reply.
 [[nodiscard]] std::optional<Reply> parse(const Tins::Packet& packet) noexcept;
 
+/// Parse a raw frame, as captured by pcap.
+/// @param link_type the link type (DLT_) of the frame, e.g. DLT_EN10MB.
+/// @return the parsed reply, or nullopt if the frame is malformed or is not
+/// a reply.
+[[nodiscard]] std::optional<Reply> parse(int link_type,
+                                         const pcap_pkthdr& header,
+                                         const u_char* data) noexcept;
+
+/// Parse a probe built by the sender (e.g. looped back with its transmit
+/// timestamp), starting from the IP header.
+/// `wait_us` is not encoded in the probes and is always 0.
+[[nodiscard]] std::optional<Probe> parse_probe(const std::byte* data,
+                                               size_t size) noexcept;
+
 }  // namespace caracal::Parser
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <pcap.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace caracal {
+
+/// Write the raw frames captured by a sniffer to a series of pcap files,
+/// from a dedicated thread.
+/// The capture thread only copies the frames into a ring buffer, and never
+/// waits for the disk: the frames that do not fit in the buffer are dropped
+/// (see `dropped`).
+/// The files are named `<prefix>-<index>.pcap` (`.pcap.zst` if compressed),
+/// with a 6-digits index starting at 0.
+class PcapWriter {
+ public:
+  struct Options {
+    /// Start a new file once the current one reaches this size (before
+    /// compression), in bytes. 0 to never rotate on size.
+    uint64_t rotate_size = 0;
+    /// Start a new file once the current one is this old. 0 to never rotate
+    /// on time.
+    std::chrono::seconds rotate_interval{0};
+    /// Compress the files with zstd, requires a build with `WITH_ZSTD`.
+    bool zstd = false;
+    /// Size of the ring buffer, in bytes, rounded up to a power of two.
+    uint64_t buffer_size = 64 * 1024 * 1024;
+    /// Maximum number of bytes kept from each frame.
+    uint32_t snaplen = 65535;
+  };
+
+  /// Start the writer thread. The first file is created on the first frame.
+  /// @param link_type the DLT_ link type of the frames, e.g. DLT_EN10MB.
+  PcapWriter(const fs::path &prefix, int link_type, const Options &options);
+
+  /// Write the remaining frames and close the current file.
+  ~PcapWriter();
+
+  PcapWriter(const PcapWriter &) = delete;
+  PcapWriter &operator=(const PcapWriter &) = delete;
+
+  /// Copy a frame into the ring buffer. Must be called from a single thread.
+  /// @return false if the buffer is full and the frame was dropped.
+  bool write(const pcap_pkthdr &header, const u_char *data) noexcept;
+
+  /// Number of frames written to the files.
+  [[nodiscard]] uint64_t written() const noexcept;
+
+  /// Number of frames dropped because the buffer was full.
+  [[nodiscard]] uint64_t dropped() const noexcept;
+
+  /// Files created so far, in order.
+  [[nodiscard]] std::vector<fs::path> files() const;
+
+  /// The n-th file of the series.
+  [[nodiscard]] static fs::path file_path(const fs::path &prefix, uint64_t n,
+                                          bool zstd);
+
+ private:
+  class File;
+
+  void run();
+  void rotate();
+
+  fs::path prefix_;
+  int link_type_;
+  Options options_;
+  std::vector<std::byte> buffer_;
+  uint64_t mask_;
+  // Written by the capture thread, read by the writer thread.
+  alignas(64) std::atomic<uint64_t> head_;
+  std::atomic<uint64_t> dropped_;
+  // Written by the writer thread, read by the capture thread.
+  alignas(64) std::atomic<uint64_t> tail_;
+  std::atomic<uint64_t> written_;
+  std::atomic<uint64_t> files_count_;
+  std::atomic<bool> stopped_;
+  std::unique_ptr<File> file_;
+  std::chrono::steady_clock::time_point file_opened_;
+  std::thread thread_;
+};
+
+}  // namespace caracal
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace caracal {
+
+/// A keyed pseudo-random permutation of [0, size), computed in constant
+/// memory with a balanced Feistel network and cycle-walking.
+/// See "Ciphers with Arbitrary Finite Domains", Black and Rogaway, 2002.
+class Permutation {
+ public:
+  /// @param size the size of the domain, > 0.
+  /// @param key the key of the permutation.
+  Permutation(uint64_t size, uint64_t key);
+
+  /// @return the image of `i`, for `i` in [0, size).
+  [[nodiscard]] uint64_t operator()(uint64_t i) const noexcept;
+
+  [[nodiscard]] uint64_t size() const noexcept;
+
+ private:
+  [[nodiscard]] uint64_t feistel(uint64_t x) const noexcept;
+
+  static constexpr int rounds = 4;
+  uint64_t size_;
+  uint64_t half_bits_;
+  uint64_t half_mask_;
+  std::array<uint64_t, rounds> keys_;
+};
+
+}  // namespace caracal
@@ -2,6 +2,7 @@
 
 #include <arpa/inet.h>
 
+#include <cstddef>
 #include <string>
 
 #include "./protocols.hpp"
@@ -23,10 +24,21 @@ struct Probe {
 
   uint32_t wait_us;  ///< Microseconds to wait before the next probe (optional)
 
+  /// Size in bytes of a probe in the binary format.
+  /// The binary format is the concatenation of the fields above, except
+  /// `protocol` which is stored as its IP protocol number, in network order.
+  static constexpr size_t binary_size = 30;
+
   [[nodiscard]] static Probe from_csv(const std::string &line);
 
   [[nodiscard]] std::string to_csv() const noexcept;
 
+  /// Read a probe from `binary_size` bytes.
+  [[nodiscard]] static Probe from_binary(const std::byte *data);
+
+  /// Write the probe to `binary_size` bytes.
+  void to_binary(std::byte *data) const noexcept;
+
   [[nodiscard]] bool operator==(const Probe &other) const noexcept;
 
   [[nodiscard]] Protocols::L3 l3_protocol() const noexcept;
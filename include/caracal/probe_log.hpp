@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include "./probe.hpp"
+
+namespace fs = std::filesystem;
+
+namespace caracal {
+
+/// Append the probes sent to a binary file, from a dedicated thread.
+/// The sending thread only copies the probes into a ring buffer, and never
+/// waits for the disk: the probes that do not fit in the buffer are dropped
+/// (see `dropped`), which leaves a gap in the sequence numbers.
+class ProbeLog {
+ public:
+  struct Record {
+    /// Index of the probe in the log, starting at the number of records
+    /// already in the file.
+    uint64_t sequence;
+    /// Time since the epoch at which the probe was sent.
+    std::chrono::nanoseconds timestamp;
+    Probe probe;
+
+    /// Size in bytes of a record in the binary format.
+    /// The binary format is the sequence number and the timestamp as 64-bit
+    /// integers in network order, the probe in its binary format (see
+    /// Probe::binary_size), and two zero bytes.
+    static constexpr size_t binary_size = 8 + 8 + Probe::binary_size + 2;
+
+    /// Read a record from `binary_size` bytes.
+    [[nodiscard]] static Record from_binary(const std::byte *data);
+
+    /// Write the record to `binary_size` bytes.
+    void to_binary(std::byte *data) const noexcept;
+  };
+
+  /// Open `path` in append mode and start the writer thread.
+  /// @param capacity the number of records of the ring buffer, rounded up to
+  /// a power of two.
+  explicit ProbeLog(const fs::path &path, size_t capacity = 1 << 20);
+
+  /// Write the remaining records and close the file.
+  ~ProbeLog();
+
+  ProbeLog(const ProbeLog &) = delete;
+  ProbeLog &operator=(const ProbeLog &) = delete;
+
+  /// Copy a probe into the ring buffer, with the next sequence number.
+  /// Must be called from a single thread.
+  /// @return false if the buffer is full and the probe was dropped.
+  bool write(const Probe &probe, std::chrono::nanoseconds timestamp) noexcept;
+
+  /// Number of records written to the file.
+  [[nodiscard]] uint64_t written() const noexcept;
+
+  /// Number of records dropped because the buffer was full.
+  [[nodiscard]] uint64_t dropped() const noexcept;
+
+ private:
+  void run();
+
+  fs::path path_;
+  std::ofstream stream_;
+  std::vector<Record> buffer_;
+  uint64_t mask_;
+  // Only used by the sending thread.
+  uint64_t sequence_;
+  // Written by the sending thread, read by the writer thread.
+  alignas(64) std::atomic<uint64_t> head_;
+  std::atomic<uint64_t> dropped_;
+  // Written by the writer thread, read by the sending thread.
+  alignas(64) std::atomic<uint64_t> tail_;
+  std::atomic<uint64_t> written_;
+  std::atomic<bool> stopped_;
+  std::thread thread_;
+};
+
+}  // namespace caracal
@@ -2,12 +2,20 @@
 
 #include <pcap.h>
 
+#include <chrono>
 #include <filesystem>
+#include <functional>
 #include <istream>
+#include <memory>
+#include <optional>
+#include <string>
 #include <tuple>
+#include <vector>
 
 #include "./probe.hpp"
 #include "./prober_config.hpp"
+#include "./protocols.hpp"
+#include "./reply_sink.hpp"
 #include "./statistics.hpp"
 
 /// Build and send probes.
@@ -20,6 +28,30 @@ using Iterator = std::function<bool(Probe&)>;
 using ProbingStatistics =
     std::tuple<Statistics::Prober, Statistics::Sniffer, pcap_stat>;
 
+/// An iterator over the probes of a CSV stream.
+/// If `stop_on_empty_line` is true, an empty line marks the end of the stream.
+Iterator csv_iterator(std::istream& is, bool stop_on_empty_line = false);
+
+/// An iterator over the probes of a binary stream (see Probe::from_binary).
+/// If `count` is set, at most `count` records are read.
+Iterator binary_iterator(std::istream& is,
+                         std::optional<uint64_t> count = std::nullopt);
+
+/// An iterator over all the (destination, TTL) pairs in [min_ttl, max_ttl],
+/// in a pseudo-random order given by `key` (as in Yarrp), so that the probes
+/// towards a destination are spread over the whole round.
+/// With ICMP (or ICMPv6), the protocol is chosen from the address family.
+/// The source and destination ports are 24000 and 33434.
+Iterator random_iterator(std::vector<in6_addr> destinations, uint8_t min_ttl,
+                         uint8_t max_ttl, Protocols::L4 protocol,
+                         uint64_t key);
+
+/// An iterator over all the addresses of IPv4 `prefixes` (e.g. 0.0.0.0/0),
+/// at TTL 255, in a pseudo-random order given by `key` (ping sweep).
+/// Overlapping prefixes are probed once per prefix.
+Iterator sweep_iterator(const std::vector<std::string>& prefixes,
+                        Protocols::L4 protocol, uint64_t key);
+
 /// Send probes from a function yielding probes.
 ProbingStatistics probe(const Config& config, Iterator& it);
 
@@ -29,4 +61,29 @@ ProbingStatistics probe(const Config& config, std::istream& is);
 /// Send probes from a file.
 ProbingStatistics probe(const Config& config, const fs::path& path);
 
+/// Run a round of the daemon mode: send the probes of `it`, and write the
+/// replies, tagged with `round`, to `sink` until it returns.
+using RoundRunner = std::function<void(Iterator& it, const std::string& round,
+                                       std::shared_ptr<ReplySink> sink)>;
+
+/// Handle a connection of the daemon mode (see serve) on the socket `fd`.
+/// The replies are flushed on return, but the socket is not closed.
+/// @param timeout the send and receive timeouts of the socket: the probes end
+/// if none is received for this long, and the replies are dropped once a
+/// write times out.
+void serve_connection(
+    int fd, const RoundRunner& run,
+    std::chrono::milliseconds timeout = std::chrono::seconds{10});
+
+/// Serve probe batches received on a Unix socket (daemon mode).
+/// The sniffer, the sender and the rate limiter are opened once, and each
+/// connection is handled as a round: the client sends a
+/// `<csv|binary> <round> [count]` header line followed by the probes, and
+/// receives the replies, tagged with the round, in CSV format until the
+/// server closes the connection.
+/// The CSV probes end with an empty line, and the binary probes after `count`
+/// records; otherwise both end when the client shuts down its side of the
+/// connection.
+void serve(const Config& config, const fs::path& socket_path);
+
 }  // namespace caracal::Prober
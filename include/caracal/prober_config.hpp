@@ -5,6 +5,7 @@
 #include <fstream>
 #include <optional>
 #include <string>
+#include <vector>
 
 #include <tins/tins.h>
 
@@ -15,6 +16,14 @@ namespace fs = std::filesystem;
 
 namespace caracal::Prober {
 
+/// An interface to send probes from, with optional source addresses
+/// (the addresses of the interface are used by default).
+struct Source {
+  string interface;
+  optional<Tins::IPv4Address> source_ipv4;
+  optional<Tins::IPv6Address> source_ipv6;
+};
+
 /// Configuration of the prober.
 struct Config {
   uint16_t caracal_id = get_default_id();
@@ -25,6 +34,9 @@ struct Config {
   bool integrity_check = true;
   std::string interface = get_default_interface();
   string rate_limiting_method = "auto";
+  string output_format = "csv";
+  optional<string> output_shm;
+  uint64_t output_shm_capacity = 1 << 16;
   optional<uint8_t> ip_version;
   optional<Tins::IPv4Address> source_ipv4;
   optional<Tins::IPv6Address> source_ipv6;
@@ -34,6 +46,25 @@ struct Config {
   optional<int> filter_min_ttl;
   optional<int> filter_max_ttl;
   optional<string> meta_round;
+  optional<uint64_t> drain_rtt_factor;
+  bool stop_set = false;
+  bool prune_reached = false;
+  optional<double> dedup_fp_rate;
+  std::vector<Source> sources;
+  std::vector<int> sender_cpus;
+  std::vector<int> sniffer_cpus;
+  std::vector<int> stats_cpus;
+  bool numa_local = false;
+  optional<int> realtime_priority;
+  optional<int> busy_poll;
+  bool qdisc_bypass = false;
+  bool strict_filter = false;
+  bool tx_timestamps = false;
+  optional<fs::path> output_pcap;
+  uint64_t output_pcap_rotate_size = 0;
+  uint64_t output_pcap_rotate_interval = 0;
+  bool output_pcap_zstd = false;
+  optional<fs::path> output_probes;
 
   static uint16_t get_default_id();
 
@@ -55,6 +86,16 @@ struct Config {
 
   void set_rate_limiting_method(const string& s);
 
+  /// Format of the replies written to stdout: csv or binary.
+  void set_output_format(const string& s);
+
+  /// Publish the replies into the named shared-memory ring instead of
+  /// stdout, see ShmRingSink.
+  void set_output_shm(const string& name);
+
+  /// Number of records of the shared-memory ring, must be a power of two.
+  void set_output_shm_capacity(int capacity);
+
   void set_ip_version(uint8_t version);
 
   void set_source_ipv4(const std::string & source_addr);
@@ -72,6 +113,88 @@ struct Config {
   void set_filter_max_ttl(int ttl);
 
   void set_meta_round(const string& round);
+
+  /// Stop waiting for replies at the end of a round once no reply has been
+  /// received for `factor` × the 99th percentile RTT. `sniffer_wait_time`
+  /// remains the upper bound.
+  void set_drain_rtt_factor(int factor);
+
+  /// Skip the probes below an interface already reached from another
+  /// destination of the same prefix (see Feedback).
+  void set_stop_set(bool enabled);
+
+  /// Skip the probes with a TTL higher than the one at which the
+  /// destination replied (see Feedback).
+  void set_prune_reached(bool enabled);
+
+  /// Do not send the same probe twice in a round, using a scalable Bloom
+  /// filter with the specified false positive rate (a false positive skips
+  /// a probe that was not sent).
+  void set_dedup_fp_rate(double rate);
+
+  /// Send probes from a source, specified as `interface[,ipv4][,ipv6]`.
+  /// The sources replace `interface` and the source addresses: to keep
+  /// sending from `interface`, add it as a source too. The probes are spread
+  /// across the sources by destination, and the replies are captured on
+  /// every interface.
+  void add_source(const string& spec);
+
+  /// Pin the send loop (the thread calling Session::run) to a CPU list
+  /// (e.g. `0-3,8`).
+  void set_sender_cpus(const string& cpus);
+
+  /// Pin the sniffer threads to a CPU list.
+  void set_sniffer_cpus(const string& cpus);
+
+  /// Pin the statistics thread to a CPU list.
+  void set_stats_cpus(const string& cpus);
+
+  /// Pin the threads without a CPU list to the NUMA node of the interface,
+  /// and open the session from this node so that the capture rings and the
+  /// send buffers are allocated in its memory.
+  void set_numa_local(bool enabled);
+
+  /// Run the send loop and the sniffer threads with the SCHED_FIFO policy
+  /// at this priority (1-99). Requires CAP_SYS_NICE.
+  void set_realtime_priority(int priority);
+
+  /// Busy poll the device queue for up to `usecs` microseconds when the
+  /// capture socket has no packets (SO_BUSY_POLL and SO_PREFER_BUSY_POLL),
+  /// and deliver the captured packets every millisecond instead of every
+  /// 100ms. This trades a core for a lower reception latency.
+  void set_busy_poll(int usecs);
+
+  /// Send the probes directly to the device, bypassing the qdisc layer
+  /// (PACKET_QDISC_BYPASS). The probes are dropped if the device queue is
+  /// full, instead of being buffered.
+  void set_qdisc_bypass(bool enabled);
+
+  /// Drop the foreign ICMP messages in the kernel: only capture the replies
+  /// sent to the source addresses, quoting ICMP or UDP probes, and with a
+  /// valid caracal checksum for IPv4 if `integrity_check` is enabled.
+  void set_strict_filter(bool enabled);
+
+  /// Read the time at which each probe was handed to the device driver from
+  /// the kernel (SO_TIMESTAMPING), instead of relying on the time at which
+  /// the probe was built. See Session::set_tx_timestamp_handler.
+  void set_tx_timestamps(bool enabled);
+
+  /// Write the raw captured frames to `<prefix>-<interface>-<index>.pcap`
+  /// files, from a dedicated thread (see PcapWriter).
+  void set_output_pcap(const fs::path& prefix);
+
+  /// Start a new capture file every `megabytes` MB (before compression).
+  void set_output_pcap_rotate_size(int megabytes);
+
+  /// Start a new capture file every `seconds` seconds.
+  void set_output_pcap_rotate_interval(int seconds);
+
+  /// Compress the capture files with zstd, requires a build with WITH_ZSTD.
+  void set_output_pcap_zstd(bool enabled);
+
+  /// Append the probes sent, with their send time and a sequence number, to
+  /// a binary file, from a dedicated thread (see ProbeLog).
+  void set_output_probes(const fs::path& path);
 };
 
 std::ostream& operator<<(std::ostream& os, Config const& v);
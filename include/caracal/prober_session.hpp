@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "./bloom_filter.hpp"
+#include "./feedback.hpp"
+#include "./lpm.hpp"
+#include "./prober.hpp"
+#include "./probe_log.hpp"
+#include "./prober_config.hpp"
+#include "./rate_limiter.hpp"
+#include "./reply_sink.hpp"
+#include "./sender.hpp"
+#include "./sniffer.hpp"
+#include "./statistics.hpp"
+
+namespace caracal::Prober {
+
+/// A probing session, which keeps the sniffer, the sender, the rate limiter
+/// and the prefix filters open across multiple rounds.
+/// This avoids paying the setup cost (gateway resolution, pcap handles, BPF
+/// filter compilation, ...) for every round of an iterative algorithm.
+/// With multiple Config::sources, there is one sender per source and one
+/// sniffer per interface, writing to the same sink.
+class Session {
+ public:
+  /// Open a session and write the replies to stdout, in the format
+  /// specified by Config::output_format, or to Config::output_shm if set.
+  explicit Session(const Config& config);
+
+  /// Open a session and send the replies to `sink` (if not null).
+  Session(const Config& config, std::shared_ptr<ReplySink> sink);
+
+  ~Session();
+
+  Session(const Session&) = delete;
+  Session& operator=(const Session&) = delete;
+
+  /// Send probes from a function yielding probes.
+  /// @param it the probes to send.
+  /// @param round_id the value of the round column in the output.
+  /// @return the statistics of this round.
+  ProbingStatistics run(Iterator& it,
+                        const std::optional<std::string>& round_id);
+
+  /// Send probes from a CSV stream (e.g. stdin).
+  ProbingStatistics run(std::istream& is,
+                        const std::optional<std::string>& round_id);
+
+  /// Send the replies to `sink`, or discard them if null.
+  void set_sink(std::shared_ptr<ReplySink> sink);
+
+  /// The sink given to set_sink (or to the constructor).
+  [[nodiscard]] const std::shared_ptr<ReplySink>& sink() const noexcept;
+
+  /// Call `handler` with the kernel transmit timestamp of each probe, if
+  /// Config::tx_timestamps is set. The handler is called from the thread
+  /// calling `run`, in the order in which the probes were sent.
+  void set_tx_timestamp_handler(Sender::TxTimestampCallback handler);
+
+  [[nodiscard]] const Config& config() const noexcept;
+
+ private:
+  void send_probes(Iterator& it);
+
+  void read_tx_timestamps();
+
+  /// Wait for the last flying replies, see Config::set_drain_rtt_factor.
+  void drain();
+
+  void log_statistics();
+
+  /// The index of the sender of the probes to this destination.
+  [[nodiscard]] size_t sender_index(const Probe& p) const noexcept;
+
+  /// Log a probe, sent by the sender `index`, with its kernel timestamp, and
+  /// the probes sent before it whose timestamp was not reported.
+  void log_tx_timestamp(size_t index, const Probe& probe,
+                        std::chrono::nanoseconds timestamp);
+
+  /// Log the probes still waiting for their kernel timestamp.
+  void flush_pending_probes();
+
+  [[nodiscard]] uint64_t replies_count() const noexcept;
+
+  /// Highest 99th percentile RTT of the sniffers, in tenth of milliseconds.
+  [[nodiscard]] uint32_t rtt_p99() const noexcept;
+
+  Statistics::Sniffer reset_sniffer_statistics();
+
+  /// The CPUs of a thread: `cpus` if not empty, else the NUMA node CPUs.
+  [[nodiscard]] std::vector<int> cpus_for(const std::vector<int>& cpus) const;
+
+  void place_sniffer(Sniffer& sniffer);
+
+  /// Grow the capture buffers which dropped packets since the last call.
+  /// Called from the stats thread, the sniffers are reopened mid-round.
+  void grow_capture_buffers();
+
+  /// Reopen a sniffer which dropped packets with a twice larger buffer.
+  /// The previous buffer is kept if the capture cannot be reopened.
+  void grow_capture_buffer(Sniffer& sniffer);
+
+  Config config_;
+  LPM prefix_excl_;
+  LPM prefix_incl_;
+  std::vector<std::unique_ptr<Sniffer>> sniffers_;
+  std::vector<std::unique_ptr<Sender>> senders_;
+  std::vector<int> numa_cpus_;
+  RateLimiter rate_limiter_;
+  Statistics::Prober statistics_;
+  std::shared_ptr<ReplySink> sink_;
+  std::shared_ptr<Feedback> feedback_;
+  Sender::TxTimestampCallback tx_timestamp_handler_;
+  std::unique_ptr<ProbeLog> probe_log_;
+  /// With transmit timestamps, the probes sent by each sender (and the time
+  /// of the send call), waiting for their kernel timestamp to be logged.
+  std::vector<std::deque<std::pair<Probe, std::chrono::nanoseconds>>>
+      pending_probes_;
+  std::optional<ScalableBloomFilter> dedup_;
+  /// The pcap drops of each sniffer at the last call of
+  /// `grow_capture_buffers`.
+  std::vector<uint64_t> checked_drops_;
+  std::atomic<bool> running_;
+  std::atomic<bool> stop_stats_thread_;
+  std::thread stats_thread_;
+};
+
+}  // namespace caracal::Prober
@@ -16,6 +16,9 @@ uint8_t posix_value(L3 const &v);
 /// Layer 4 protocol constant (e.g. IPPROTO_ICMP).
 uint8_t posix_value(L4 const &v);
 
+/// Layer 4 protocol from its constant (e.g. IPPROTO_ICMP).
+L4 l4_from_posix(uint8_t v);
+
 L4 l4_from_string(std::string const &s);
 std::string to_string(L4 const &v);
 
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <pcap.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "./reply_sink.hpp"
+#include "./statistics.hpp"
+
+namespace fs = std::filesystem;
+
+/// Parse the replies of archived captures again (e.g. after a parser fix).
+namespace caracal::Reparse {
+
+/// A pcap or pcapng file mapped in memory, and the index of its frames.
+class CaptureFile {
+ public:
+  struct Frame {
+    /// Capture time (rounded down to the microsecond) and lengths.
+    pcap_pkthdr header;
+    /// Link type (DLT_) of the interface of the frame.
+    int link_type;
+    /// Points into the mapping, valid as long as the file.
+    const u_char *data;
+  };
+
+  /// Map the file and index its frames. A truncated last frame (e.g. from
+  /// a capture that was killed) is ignored.
+  /// @throw std::invalid_argument if the file is neither a pcap nor a pcapng
+  /// file, including if it is compressed with zstd (the compressed files
+  /// must be decompressed first).
+  explicit CaptureFile(const fs::path &path);
+
+  ~CaptureFile();
+
+  CaptureFile(const CaptureFile &) = delete;
+  CaptureFile &operator=(const CaptureFile &) = delete;
+
+  [[nodiscard]] const std::vector<Frame> &frames() const noexcept;
+
+ private:
+  void index_pcap();
+  void index_pcapng();
+
+  fs::path path_;
+  const std::byte *data_;
+  size_t size_;
+  std::vector<Frame> frames_;
+};
+
+struct Options {
+  /// See Prober::Config::set_caracal_id.
+  uint16_t caracal_id = 0;
+  /// Drop the replies that fail Reply::is_valid.
+  bool integrity_check = true;
+  /// Value of the round column of the replies.
+  std::optional<std::string> meta_round;
+  /// Number of parsing threads.
+  unsigned threads = std::max(std::thread::hardware_concurrency(), 1U);
+  /// Number of frames parsed at once by a thread.
+  size_t range_size = 16384;
+};
+
+/// Parse the frames of `files` on `options.threads` threads, and write the
+/// valid replies to `sink` from the calling thread, in capture order (the
+/// order of the files, then the order of the frames in each file).
+/// @return the statistics of the frames, as reported by the sniffer.
+Statistics::Sniffer reparse(const std::vector<fs::path> &files,
+                            ReplySink &sink, const Options &options);
+
+/// Same as above, but the replies are also serialized in `format` (csv or
+/// binary, see make_sink) by the parsing threads.
+Statistics::Sniffer reparse(const std::vector<fs::path> &files,
+                            std::ostream &os, const std::string &format,
+                            const Options &options);
+
+}  // namespace caracal::Reparse
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <netinet/in.h>
+
+#include <cstddef>
 #include <string>
 #include <tuple>
 #include <vector>
@@ -88,6 +91,22 @@ struct Reply {
   [[nodiscard]] std::string to_csv(const std::string &round) const;
 
   [[nodiscard]] static std::string csv_header();
+
+  /// Maximum number of MPLS labels stored in the binary format.
+  static constexpr size_t binary_mpls_labels = 4;
+
+  /// Size in bytes of a reply in the binary format.
+  /// The binary format is the concatenation of the fields above, in network
+  /// order, followed by the number of MPLS labels (1 byte) and by
+  /// `binary_mpls_labels` RFC 4950 label stack entries (4 bytes each).
+  /// Labels beyond `binary_mpls_labels` are dropped.
+  static constexpr size_t binary_size = 81 + 1 + binary_mpls_labels * 4;
+
+  /// Write the reply to `binary_size` bytes.
+  void to_binary(std::byte *data) const noexcept;
+
+  /// Read a reply from `binary_size` bytes.
+  [[nodiscard]] static Reply from_binary(const std::byte *data);
 };
 
 std::ostream &operator<<(std::ostream &os, Reply const &v);
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+#include "./reply.hpp"
+
+namespace caracal {
+
+/// A destination for the replies captured by the sniffer.
+/// The methods are called from the sniffer thread, one reply at a time.
+class ReplySink {
+ public:
+  virtual ~ReplySink() = default;
+
+  /// Handle a valid reply.
+  /// @param reply the reply, only valid for the duration of the call.
+  /// @param round the value of the round column.
+  virtual void write(const Reply &reply, const std::string &round) = 0;
+
+  /// Flush the buffered replies, if any.
+  virtual void flush() {}
+};
+
+/// Write the replies in CSV format (see Reply::to_csv).
+class CsvSink : public ReplySink {
+ public:
+  /// Write the CSV header to `os`.
+  explicit CsvSink(std::ostream &os);
+
+  void write(const Reply &reply, const std::string &round) override;
+
+  void flush() override;
+
+ private:
+  std::ostream &os_;
+};
+
+/// Write the replies in binary format (see Reply::to_binary).
+/// The round is not included in the output.
+class BinarySink : public ReplySink {
+ public:
+  explicit BinarySink(std::ostream &os);
+
+  void write(const Reply &reply, const std::string &round) override;
+
+  void flush() override;
+
+ private:
+  std::ostream &os_;
+};
+
+/// Call a function for each reply.
+class CallbackSink : public ReplySink {
+ public:
+  using Callback = std::function<void(const Reply &, const std::string &)>;
+
+  explicit CallbackSink(Callback callback);
+
+  void write(const Reply &reply, const std::string &round) override;
+
+ private:
+  Callback callback_;
+};
+
+/// Serialize the calls to another sink, so that it can be shared by
+/// several sniffers.
+class SynchronizedSink : public ReplySink {
+ public:
+  explicit SynchronizedSink(std::shared_ptr<ReplySink> sink);
+
+  void write(const Reply &reply, const std::string &round) override;
+
+  void flush() override;
+
+ private:
+  std::shared_ptr<ReplySink> sink_;
+  std::mutex mutex_;
+};
+
+/// Build a sink writing to `os` in the specified format (csv or binary).
+[[nodiscard]] std::shared_ptr<ReplySink> make_sink(const std::string &format,
+                                                   std::ostream &os);
+
+}  // namespace caracal
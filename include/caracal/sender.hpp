@@ -5,11 +5,16 @@
 #include <pcap/pcap.h>
 
 #include <array>
+#include <chrono>
+#include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include <caracal/prober.hpp>
 
 #include "./probe.hpp"
+#include "./protocols.hpp"
 
 namespace caracal {
 
@@ -17,18 +22,48 @@ class Sender {
  public:
   explicit Sender(const Prober::Config &);
 
-  ~Sender();
-
   void send(const Probe &probe);
 
+  /// Called with a probe and the time since the epoch at which it was sent.
+  using TxTimestampCallback =
+      std::function<void(const Probe &, std::chrono::nanoseconds)>;
+
+  /// Read the transmit timestamps available, without blocking, if enabled
+  /// (see Prober::Config::set_tx_timestamps).
+  /// @return the number of timestamps read.
+  size_t read_tx_timestamps(const TxTimestampCallback &callback);
+
+  /// Whether the transmit timestamps are enabled and supported.
+  [[nodiscard]] bool tx_timestamps() const noexcept;
+
+  /// The IPv4 (IPv4-mapped) and IPv6 source addresses of the probes.
+  [[nodiscard]] std::vector<in6_addr> source_addresses() const;
+
  private:
+  /// Build and send a probe, with the header offsets and the builders
+  /// chosen at compile time.
+  template <Protocols::L2 L2, Protocols::L3 L3, Protocols::L4 L4>
+  void send(const Probe &probe, uint16_t timestamp_enc);
+
+  using SendFunction = void (Sender::*)(const Probe &, uint16_t);
+
+  /// The specializations of `send` for a L2 protocol, indexed by L3 and L4
+  /// protocol.
+  using SendFunctions = std::array<std::array<SendFunction, 3>, 2>;
+
+  template <Protocols::L2 L2>
+  static SendFunctions send_functions();
+
   std::array<std::byte, 65536> buffer_;
   Protocols::L2 l2_protocol_;
+  SendFunctions send_functions_;
   std::array<uint8_t, ETHER_ADDR_LEN> src_mac_;
-  std::array<uint8_t, ETHER_ADDR_LEN> dst_mac_;
+  std::array<uint8_t, ETHER_ADDR_LEN> dst_mac_v4_;
+  std::array<uint8_t, ETHER_ADDR_LEN> dst_mac_v6_;
   sockaddr_in src_ip_v4_;
   sockaddr_in6 src_ip_v6_;
   uint16_t caracal_id_;
-  pcap_t *handle_;
+  bool tx_timestamps_;
+  std::unique_ptr<pcap_t, decltype(&pcap_close)> handle_;
 };
 }  // namespace caracal
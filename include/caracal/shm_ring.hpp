@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "./reply.hpp"
+#include "./reply_sink.hpp"
+
+namespace caracal {
+
+/// Publish the replies into a named POSIX shared-memory ring, as fixed-size
+/// Reply::to_binary records, for consumers running on the same host.
+/// The ring has a single producer and any number of consumers (see
+/// ShmRingReader). The producer never waits for the consumers: a consumer
+/// that falls more than `capacity` records behind loses the oldest ones.
+class ShmRingSink : public ReplySink {
+ public:
+  /// Create (or replace) the shared-memory object `/dev/shm/<name>`.
+  /// @param name the name of the ring, e.g. `/caracal`.
+  /// @param capacity the number of records, must be a power of two.
+  ShmRingSink(const std::string &name, uint64_t capacity);
+
+  /// Unmap and unlink the ring, consumers that are still attached keep
+  /// their mapping.
+  ~ShmRingSink() override;
+
+  ShmRingSink(const ShmRingSink &) = delete;
+  ShmRingSink &operator=(const ShmRingSink &) = delete;
+
+  void write(const Reply &reply, const std::string &round) override;
+
+  /// Number of records written since the creation of the ring.
+  [[nodiscard]] uint64_t sequence() const noexcept;
+
+ private:
+  std::string name_;
+  std::byte *data_;
+  size_t size_;
+};
+
+/// Consume the replies published by a ShmRingSink.
+class ShmRingReader {
+ public:
+  /// Attach to an existing ring, starting at the next record written.
+  explicit ShmRingReader(const std::string &name);
+
+  ~ShmRingReader();
+
+  ShmRingReader(const ShmRingReader &) = delete;
+  ShmRingReader &operator=(const ShmRingReader &) = delete;
+
+  /// Read the next record, if any.
+  /// @return false if no new record is available.
+  bool read(Reply &reply);
+
+  /// Sequence number of the next record to read.
+  [[nodiscard]] uint64_t sequence() const noexcept;
+
+  /// Number of records overwritten by the producer before they could be read.
+  [[nodiscard]] uint64_t overruns() const noexcept;
+
+ private:
+  const std::byte *data_;
+  size_t size_;
+  uint64_t sequence_;
+  uint64_t overruns_;
+};
+
+}  // namespace caracal
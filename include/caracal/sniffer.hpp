@@ -1,25 +1,77 @@
 #pragma once
 
+#include <netinet/in.h>
 #include <tins/tins.h>
 
+#include <atomic>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <ostream>
 #include <string>
 #include <thread>
+#include <vector>
 
+#include "./feedback.hpp"
+#include "./pcap_writer.hpp"
+#include "./reply_sink.hpp"
 #include "./statistics.hpp"
 
 namespace fs = std::filesystem;
 
 namespace caracal {
 
+/// Settings of the capture buffer of the sniffer.
+struct CaptureSettings {
+  static constexpr uint64_t min_buffer_size = 16 * 1024 * 1024;
+  static constexpr uint64_t max_buffer_size = 1024 * 1024 * 1024;
+
+  /// Size of the kernel buffer, in bytes.
+  uint64_t buffer_size = 64 * 1024 * 1024;
+  /// Delay before delivering a partially filled buffer, in milliseconds.
+  int timeout = 100;
+  /// Deliver the packets as soon as they arrive.
+  bool immediate_mode = false;
+  /// See Prober::Config::set_busy_poll.
+  std::optional<int> busy_poll;
+};
+
+/// Capture settings for an expected number of replies per second: a large
+/// buffer and batched deliveries at high rates, and immediate deliveries at
+/// low rates, where the latency matters more than the overhead.
+[[nodiscard]] CaptureSettings capture_settings(
+    uint64_t reply_rate, std::optional<int> busy_poll = std::nullopt);
+
+std::ostream &operator<<(std::ostream &os, CaptureSettings const &v);
+
+/// The kernel (BPF) filter of the sniffer, which accepts the ICMP(v6) echo
+/// replies, time exceeded and destination unreachable messages.
+/// The default filter accepts all of them, the other options drop the
+/// foreign replies before they are copied to the userspace.
+struct SnifferFilter {
+  /// Only accept the replies sent to these addresses (IPv4-mapped for IPv4),
+  /// or to any address if empty.
+  std::vector<in6_addr> addresses;
+  /// Only accept the ICMP errors quoting an ICMP(v6) or UDP probe.
+  bool quoted_protocols = false;
+  /// Only accept the IPv4 ICMP errors with a valid caracal checksum, as
+  /// Reply::is_valid does (the errors quoting IP options are accepted).
+  std::optional<uint16_t> caracal_id;
+
+  [[nodiscard]] std::string to_string() const;
+};
+
 class Sniffer {
  public:
+  /// @param settings the capture buffer settings.
+  /// @param filter the kernel filter of the replies.
   Sniffer(const std::string &interface_name,
           const std::optional<std::string> &meta_round, uint16_t caracal_id,
-          bool integrity_check);
+          bool integrity_check, const CaptureSettings &settings = {},
+          const SnifferFilter &filter = {});
 
   ~Sniffer();
 
@@ -27,16 +79,82 @@ class Sniffer {
 
   void stop() noexcept;
 
+  /// Reopen the capture with new settings (e.g. a larger buffer after
+  /// drops). The packets received during the reopening are lost.
+  /// If the capture cannot be reopened, the previous one is kept (and
+  /// restarted) and the exception is rethrown.
+  /// Can be called while another thread reads the pcap statistics or the
+  /// capture settings.
+  void reopen(const CaptureSettings &settings);
+
+  /// Send the replies to `sink`, or discard them if null (the default).
+  /// The previous sink is flushed.
+  void set_sink(std::shared_ptr<ReplySink> sink);
+
+  /// Report the valid replies to `feedback`, if not null.
+  void set_feedback(std::shared_ptr<Feedback> feedback);
+
+  /// Copy the raw captured frames (valid replies or not) to `writer`, if not
+  /// null. Must be called while the sniffer is stopped.
+  void set_pcap_writer(std::shared_ptr<PcapWriter> writer);
+
+  [[nodiscard]] const std::shared_ptr<PcapWriter> &pcap_writer()
+      const noexcept;
+
+  /// Set the value of the round column of the replies.
+  void set_meta_round(const std::optional<std::string> &meta_round);
+
+  /// Reset the statistics and return their previous value.
+  Statistics::Sniffer reset_statistics();
+
   [[nodiscard]] const Statistics::Sniffer &statistics() const noexcept;
 
+  /// Distribution of the RTTs of the valid replies since the sniffer started.
+  [[nodiscard]] const Statistics::RttHistogram &rtt_histogram() const noexcept;
+
+  /// Capture time of the last valid reply.
+  [[nodiscard]] std::chrono::steady_clock::time_point last_reply_time()
+      const noexcept;
+
+  /// Number of valid replies since the last statistics reset.
+  [[nodiscard]] uint64_t replies_count() const noexcept;
+
+  /// The pcap statistics since the sniffer was created, across reopenings.
   [[nodiscard]] pcap_stat pcap_statistics() noexcept;
 
+  [[nodiscard]] CaptureSettings capture_settings() const noexcept;
+
+  /// Link type (DLT_) of the captured frames.
+  [[nodiscard]] int link_type() const noexcept;
+
+  /// Handle of the capture thread, valid once started.
+  [[nodiscard]] std::thread::native_handle_type native_handle() noexcept;
+
  private:
+  void open();
+
+  void handle(const pcap_pkthdr &header, const u_char *data);
+
   Tins::Sniffer sniffer_;
-  std::optional<Tins::PacketWriter> output_pcap_;
+  std::string interface_name_;
+  std::string filter_;
+  CaptureSettings settings_;
+  /// The pcap statistics of the handles closed by `reopen`.
+  pcap_stat closed_pcap_statistics_;
+  /// Protects the handle and the settings replaced by `reopen`.
+  mutable std::mutex capture_mutex_;
+  int link_type_;
+  std::shared_ptr<PcapWriter> pcap_writer_;
   std::optional<std::string> meta_round_;
+  std::shared_ptr<ReplySink> sink_;
+  std::shared_ptr<Feedback> feedback_;
+  std::mutex sink_mutex_;
   std::thread thread_;
+  std::atomic<bool> stopped_;
   Statistics::Sniffer statistics_;
+  Statistics::RttHistogram rtt_histogram_;
+  std::atomic<std::chrono::steady_clock::rep> last_reply_time_;
+  std::atomic<uint64_t> replies_count_;
   uint16_t caracal_id_;
   bool integrity_check_;
 };
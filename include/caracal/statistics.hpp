@@ -4,7 +4,9 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <caracal/constants.hpp>
+#include <caracal/reply.hpp>
 #include <chrono>
 #include <numeric>
 #include <ostream>
@@ -75,14 +77,76 @@ class CircularArray {
   size_type cursor_;
 };
 
+/// A histogram of round-trip times (in tenth of milliseconds) with 1ms buckets.
+/// It can be updated by one thread while being read by another.
+class RttHistogram {
+ public:
+  void push_back(uint16_t rtt) noexcept;
+
+  [[nodiscard]] uint64_t size() const noexcept;
+
+  /// The RTT under which a fraction `q` of the values fall, rounded up to the
+  /// next bucket, in tenth of milliseconds (0 if the histogram is empty).
+  [[nodiscard]] uint32_t percentile(double q) const noexcept;
+
+ private:
+  static constexpr uint32_t bucket_width = 10;
+  std::array<std::atomic<uint64_t>, 65536 / bucket_width + 1> buckets_{};
+  std::atomic<uint64_t> size_{};
+};
+
+/// A fixed-size array of counters. They can be incremented by one thread while
+/// being read by another, the copies are not atomic as a whole.
+template <size_t N>
+class Counters {
+ public:
+  Counters() noexcept = default;
+
+  Counters(const Counters& other) noexcept { *this = other; }
+
+  Counters& operator=(const Counters& other) noexcept {
+    for (size_t i = 0; i < N; i++) {
+      values_[i].store(other[i], std::memory_order_relaxed);
+    }
+    return *this;
+  }
+
+  Counters& operator+=(const Counters& other) noexcept {
+    for (size_t i = 0; i < N; i++) {
+      values_[i].fetch_add(other[i], std::memory_order_relaxed);
+    }
+    return *this;
+  }
+
+  void increment(size_t i) noexcept {
+    values_[i].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] uint64_t operator[](size_t i) const noexcept {
+    return values_[i].load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] static constexpr size_t size() noexcept { return N; }
+
+ private:
+  std::array<std::atomic<uint64_t>, N> values_{};
+};
+
 struct Prober {
   uint64_t read = 0;
   uint64_t sent = 0;
   uint64_t failed = 0;
+  uint64_t filtered_duplicate = 0;
   uint64_t filtered_lo_ttl = 0;
   uint64_t filtered_hi_ttl = 0;
   uint64_t filtered_prefix_excl = 0;
   uint64_t filtered_prefix_not_incl = 0;
+  uint64_t filtered_stop_set = 0;
+  uint64_t filtered_reached = 0;
+  uint64_t tx_timestamps = 0;
+  /// Number of probes logged (see ProbeLog) with the time of the send call,
+  /// because their kernel timestamp was not reported.
+  uint64_t tx_timestamps_missing = 0;
 };
 
 struct RateLimiter {
@@ -112,6 +176,17 @@ struct Sniffer {
       icmp_messages_all;
   std::unordered_set<in6_addr, in6_addr_hash, in6_addr_equal_to>
       icmp_messages_path;
+  /// Valid replies by probe protocol (ICMP, ICMPv6, UDP) and probe TTL.
+  Counters<3 * 256> replies_by_ttl;
+  /// Valid ICMP replies by protocol (ICMP, ICMPv6), type and code. The codes
+  /// above 15 (none is defined at the moment) are counted as 15.
+  Counters<2 * 256 * 16> replies_by_icmp;
+
+  /// Count a valid reply.
+  void observe(const Reply& reply);
+
+  /// Merge the statistics of another sniffer.
+  Sniffer& operator+=(const Sniffer& other);
 };
 
 std::ostream& operator<<(std::ostream& os, Prober const& v);
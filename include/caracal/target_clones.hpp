@@ -0,0 +1,11 @@
+#pragma once
+
+/// Compile the annotated function for the baseline x86-64 and for the
+/// x86-64-v2 (SSE4.2, POPCNT) and x86-64-v3 (AVX2, BMI2) levels, the loader
+/// picks the best version for the CPU (see WITH_TARGET_CLONES).
+#ifdef CARACAL_WITH_TARGET_CLONES
+#define CARACAL_TARGET_CLONES \
+  __attribute__((target_clones("default", "arch=x86-64-v2", "arch=x86-64-v3")))
+#else
+#define CARACAL_TARGET_CLONES
+#endif
@@ -3,6 +3,8 @@
 #include <arpa/inet.h>
 #include <tins/tins.h>
 
+#include <istream>
+#include <optional>
 #include <set>
 #include <string>
 
@@ -21,6 +23,23 @@ namespace caracal::Utilities {
     const Tins::NetworkInterface& interface,
     const Tins::IPv4Address& destination);
 
+/// IPv6 default gateway of the interface, from a routing table in the format
+/// of /proc/net/ipv6_route: the next hop of the default route with the lowest
+/// metric, or nullopt if there is none.
+[[nodiscard]] std::optional<in6_addr> default_gateway_ipv6(
+    std::istream& routes, const std::string& interface);
+
+/// IPv6 default gateway of the interface, from the routing table.
+/// Only implemented on Linux, returns nullopt elsewhere.
+[[nodiscard]] std::optional<in6_addr> gateway_ipv6_for(
+    const Tins::NetworkInterface& interface);
+
+/// MAC address of the IPv6 default gateway of the interface, from the
+/// neighbor table (the neighbor discovery is triggered if needed).
+/// Only implemented on Linux, returns nullopt elsewhere.
+[[nodiscard]] std::optional<Tins::HWAddress<6>> gateway_mac_v6_for(
+    const Tins::NetworkInterface& interface);
+
 [[nodiscard]] std::string format_addr(const in6_addr& addr) noexcept;
 
 void parse_addr(const std::string& src, in6_addr& dst);
@@ -0,0 +1,175 @@
+#include <pthread.h>
+#include <sched.h>
+#include <spdlog/fmt/ostr.h>
+#include <spdlog/spdlog.h>
+
+#include <caracal/affinity.hpp>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace caracal::Affinity {
+
+std::vector<int> parse_cpu_list(const std::string& s) {
+  std::vector<int> cpus;
+  std::istringstream ss{s};
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    int first = 0;
+    int last = 0;
+    char sep = 0;
+    std::istringstream rs{range};
+    if (!(rs >> first) || first < 0) {
+      throw std::invalid_argument(s + " is not a valid CPU list");
+    }
+    last = first;
+    if (rs >> sep && (sep != '-' || !(rs >> last) || last < first)) {
+      throw std::invalid_argument(s + " is not a valid CPU list");
+    }
+    if (rs.peek() != std::char_traits<char>::eof()) {
+      throw std::invalid_argument(s + " is not a valid CPU list");
+    }
+    for (int cpu = first; cpu <= last; cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+  if (cpus.empty()) {
+    throw std::invalid_argument(s + " is not a valid CPU list");
+  }
+  return cpus;
+}
+
+std::string format_cpu_list(const std::vector<int>& cpus) {
+  std::string s;
+  for (const auto cpu : cpus) {
+    s += (s.empty() ? "" : ",") + std::to_string(cpu);
+  }
+  return s;
+}
+
+std::vector<int> numa_node_cpus(const std::string& interface) {
+  std::ifstream node_file{"/sys/class/net/" + interface + "/device/numa_node"};
+  int node = -1;
+  if (!(node_file >> node) || node < 0) {
+    return {};
+  }
+  std::ifstream cpus_file{"/sys/devices/system/node/node" +
+                          std::to_string(node) + "/cpulist"};
+  std::string cpus;
+  if (!std::getline(cpus_file, cpus)) {
+    return {};
+  }
+  return parse_cpu_list(cpus);
+}
+
+void set_thread_placement(pthread_t thread, const std::string& name,
+                          const std::vector<int>& cpus,
+                          std::optional<int> realtime_priority) {
+  if (cpus.empty() && !realtime_priority) {
+    return;
+  }
+#ifdef __linux__
+  if (!cpus.empty()) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const auto cpu : cpus) {
+      if (cpu >= CPU_SETSIZE) {
+        throw std::invalid_argument("cpu " + std::to_string(cpu) +
+                                    " is out of range");
+      }
+      CPU_SET(cpu, &set);
+    }
+    if (auto error = pthread_setaffinity_np(thread, sizeof(set), &set)) {
+      throw std::system_error(error, std::generic_category(),
+                              "pthread_setaffinity_np");
+    }
+  }
+  if (realtime_priority) {
+    sched_param param{};
+    param.sched_priority = *realtime_priority;
+    if (auto error = pthread_setschedparam(thread, SCHED_FIFO, &param)) {
+      throw std::system_error(error, std::generic_category(),
+                              "pthread_setschedparam");
+    }
+  }
+  spdlog::info("thread={} cpus={} realtime_priority={}", name,
+               cpus.empty() ? "any" : format_cpu_list(cpus),
+               realtime_priority.value_or(0));
+#else
+  (void)thread;
+  spdlog::warn("thread={} placement is only supported on Linux", name);
+#endif
+}
+
+ScopedThreadPlacement::ScopedThreadPlacement(
+    pthread_t thread, const std::string& name, const std::vector<int>& cpus,
+    std::optional<int> realtime_priority)
+    : thread_{thread}, name_{name}, cpus_{}, policy_{} {
+#ifdef __linux__
+  if (!cpus.empty()) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (auto error = pthread_getaffinity_np(thread, sizeof(set), &set)) {
+      throw std::system_error(error, std::generic_category(),
+                              "pthread_getaffinity_np");
+    }
+    cpus_.emplace();
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus_->push_back(cpu);
+      }
+    }
+  }
+  if (realtime_priority) {
+    int policy = 0;
+    sched_param param{};
+    if (auto error = pthread_getschedparam(thread, &policy, &param)) {
+      throw std::system_error(error, std::generic_category(),
+                              "pthread_getschedparam");
+    }
+    policy_ = {policy, param.sched_priority};
+  }
+#endif
+  try {
+    set_thread_placement(thread, name, cpus, realtime_priority);
+  } catch (...) {
+    // E.g. the affinity was applied but the real-time policy was refused.
+    restore();
+    throw;
+  }
+}
+
+ScopedThreadPlacement::~ScopedThreadPlacement() { restore(); }
+
+void ScopedThreadPlacement::restore() noexcept {
+#ifdef __linux__
+  // Restore the policy first, in case the previous CPUs are busy with other
+  // real-time threads.
+  if (policy_) {
+    sched_param param{};
+    param.sched_priority = policy_->second;
+    if (auto error = pthread_setschedparam(thread_, policy_->first, &param)) {
+      spdlog::warn("thread={} error=pthread_setschedparam: {}", name_,
+                   std::strerror(error));
+    }
+  }
+  if (cpus_) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const auto cpu : *cpus_) {
+      CPU_SET(cpu, &set);
+    }
+    if (auto error = pthread_setaffinity_np(thread_, sizeof(set), &set)) {
+      spdlog::warn("thread={} error=pthread_setaffinity_np: {}", name_,
+                   std::strerror(error));
+    }
+  }
+#endif
+}
+
+}  // namespace caracal::Affinity
@@ -0,0 +1,84 @@
+#include <arpa/inet.h>
+#include <sys/mman.h>
+
+#include <array>
+#include <caracal/bitmap_sink.hpp>
+#include <caracal/reply.hpp>
+#include <cerrno>
+#include <ostream>
+#include <string>
+#include <system_error>
+
+namespace caracal {
+
+namespace {
+
+constexpr uint64_t words_size = BitmapSink::size / 64 * sizeof(uint64_t);
+
+void write_run(std::ostream &os, const uint32_t first, const uint32_t last) {
+  std::array<uint32_t, 2> run{htonl(first), htonl(last)};
+  os.write(reinterpret_cast<const char *>(run.data()), sizeof(run));
+}
+
+}  // namespace
+
+BitmapSink::BitmapSink() : words_{nullptr}, count_{0} {
+  // Anonymous mappings are zero-filled and lazily allocated.
+  auto ptr = mmap(nullptr, words_size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (ptr == MAP_FAILED) {
+    throw std::system_error(errno, std::generic_category(), "mmap");
+  }
+  words_ = static_cast<uint64_t *>(ptr);
+}
+
+BitmapSink::~BitmapSink() { munmap(words_, words_size); }
+
+void BitmapSink::write(const Reply &reply, const std::string &) {
+  if (!IN6_IS_ADDR_V4MAPPED(&reply.reply_src_addr) ||
+      !IN6_ARE_ADDR_EQUAL(&reply.reply_src_addr, &reply.probe_dst_addr) ||
+      !(reply.is_echo_reply() || reply.is_destination_unreachable())) {
+    return;
+  }
+  const uint32_t addr = ntohl(reply.reply_src_addr.s6_addr32[3]);
+  const uint64_t bit = uint64_t{1} << (addr % 64);
+  auto &word = words_[addr / 64];
+  if (!(word & bit)) {
+    word |= bit;
+    count_++;
+  }
+}
+
+bool BitmapSink::contains(const uint32_t addr) const noexcept {
+  return words_[addr / 64] & (uint64_t{1} << (addr % 64));
+}
+
+uint64_t BitmapSink::count() const noexcept { return count_; }
+
+void BitmapSink::dump(std::ostream &os) const {
+  bool in_run = false;
+  uint64_t first = 0;
+  for (uint64_t i = 0; i < size / 64; i++) {
+    const auto word = words_[i];
+    // Fast path for the (common) words without transitions.
+    if ((!in_run && word == 0) || (in_run && word == ~uint64_t{0})) {
+      continue;
+    }
+    for (uint64_t j = 0; j < 64; j++) {
+      const bool set = word & (uint64_t{1} << j);
+      if (set && !in_run) {
+        first = i * 64 + j;
+        in_run = true;
+      } else if (!set && in_run) {
+        write_run(os, static_cast<uint32_t>(first),
+                  static_cast<uint32_t>(i * 64 + j - 1));
+        in_run = false;
+      }
+    }
+  }
+  if (in_run) {
+    write_run(os, static_cast<uint32_t>(first), UINT32_MAX);
+  }
+}
+
+}  // namespace caracal
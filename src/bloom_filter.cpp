@@ -0,0 +1,195 @@
+#include <caracal/bloom_filter.hpp>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+
+namespace caracal {
+
+BloomFilter::BloomFilter(const uint64_t size_log2, const uint64_t hashes)
+    : blocks_log2_{0}, hashes_{hashes}, words_{} {
+  if (size_log2 < 9 || size_log2 > 40) {
+    throw std::domain_error("Bloom filter size must be in [2^9, 2^40] bits");
+  }
+  if (hashes < 1 || hashes > 2 * block_words) {
+    throw std::domain_error("Bloom filter hashes must be in [1, 16]");
+  }
+  blocks_log2_ = size_log2 - 9;
+  words_ = std::make_unique<std::atomic<uint64_t>[]>(
+      (uint64_t{1} << blocks_log2_) * block_words);
+}
+
+uint64_t BloomFilter::block_index(const uint64_t hash) const noexcept {
+  // The low 48 bits of the hash select one bit in each word of the block,
+  // the block is selected by Fibonacci hashing on all the bits.
+  if (blocks_log2_ == 0) {
+    return 0;
+  }
+  return (hash * 0x9e3779b97f4a7c15ULL) >> (64 - blocks_log2_);
+}
+
+uint64_t BloomFilter::word_mask(const uint64_t hash, const uint64_t extra,
+                                const uint64_t word) const noexcept {
+  // The bits beyond the 8th are taken from a second hash.
+  uint64_t mask = word < hashes_ ? uint64_t{1} << ((hash >> (6 * word)) & 63)
+                                 : 0;
+  if (word + block_words < hashes_) {
+    mask |= uint64_t{1} << ((extra >> (6 * word)) & 63);
+  }
+  return mask;
+}
+
+bool BloomFilter::insert(const uint64_t hash) noexcept {
+  auto block = &words_[block_index(hash) * block_words];
+  const uint64_t extra = hashes_ > block_words ? mix64(hash) : 0;
+  bool inserted = false;
+  for (uint64_t i = 0; i < block_words; i++) {
+    const auto mask = word_mask(hash, extra, i);
+    if ((block[i].load(std::memory_order_relaxed) & mask) != mask) {
+      block[i].fetch_or(mask, std::memory_order_relaxed);
+      inserted = true;
+    }
+  }
+  return inserted;
+}
+
+bool BloomFilter::contains(const uint64_t hash) const noexcept {
+  auto block = &words_[block_index(hash) * block_words];
+  const uint64_t extra = hashes_ > block_words ? mix64(hash) : 0;
+  for (uint64_t i = 0; i < block_words; i++) {
+    const auto mask = word_mask(hash, extra, i);
+    if ((block[i].load(std::memory_order_relaxed) & mask) != mask) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void BloomFilter::clear() noexcept {
+  for (uint64_t i = 0; i < (uint64_t{1} << blocks_log2_) * block_words; i++) {
+    words_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+uint64_t BloomFilter::size() const noexcept {
+  return (uint64_t{1} << blocks_log2_) * block_words * 64;
+}
+
+namespace {
+
+/// False positive rate of a blocked Bloom filter with `keys_per_block` keys
+/// per block on average. The loads of the blocks follow a Poisson
+/// distribution, and the false positive rate of the most loaded blocks
+/// dominates: see "Cache-, Hash- and Space-Efficient Bloom Filters", Putze et
+/// al., 2007.
+double blocked_fp_rate(const double keys_per_block, const uint64_t hashes) {
+  // Each key sets `low` bits in some words, and `low + 1` in the others.
+  const uint64_t low = hashes / 8;
+  const auto high_words = static_cast<double>(hashes % 8);
+  const auto low_words = 8 - high_words;
+  // Probability that a bit of a word with `low` (or `low + 1`) bits per key
+  // is still unset after `keys` keys.
+  const auto q_low = std::pow(1 - 1.0 / 64, static_cast<double>(low));
+  const auto q_high = q_low * (1 - 1.0 / 64);
+  double unset_low = 1;
+  double unset_high = 1;
+  double fp_rate = 0;
+  double probability = std::exp(-keys_per_block);
+  const auto last = keys_per_block + 12 * std::sqrt(keys_per_block) + 20;
+  for (double keys = 0; keys <= last; keys++) {
+    fp_rate += probability *
+               std::pow(1 - unset_high, (low + 1) * high_words) *
+               std::pow(1 - unset_low, low * low_words);
+    probability *= keys_per_block / (keys + 1);
+    unset_low *= q_low;
+    unset_high *= q_high;
+  }
+  return fp_rate;
+}
+
+/// Number of keys per block for which a blocked Bloom filter reaches
+/// `fp_rate`.
+double max_keys_per_block(const double fp_rate, const uint64_t hashes) {
+  // At least 4 bits per key.
+  double lo = 0;
+  double hi = 128;
+  for (int i = 0; i < 30; i++) {
+    const auto mid = (lo + hi) / 2;
+    if (blocked_fp_rate(mid, hashes) <= fp_rate) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+}  // namespace
+
+ScalableBloomFilter::ScalableBloomFilter(const double fp_rate,
+                                         const uint64_t initial_size_log2)
+    : fp_rate_{fp_rate}, next_size_log2_{initial_size_log2}, stages_{} {
+  if (fp_rate <= 0 || fp_rate >= 1) {
+    throw std::domain_error("fp_rate must be in ]0, 1[");
+  }
+  grow();
+}
+
+void ScalableBloomFilter::grow() {
+  // Tightening ratio of 0.85: the false positive rates of the stages are
+  // p (1 - r), p (1 - r) r, p (1 - r) r^2, ..., whose sum is bounded by p.
+  // A ratio of 1/2 halves the rate at each stage, and the bits per key of the
+  // later stages grow much faster than the number of keys.
+  constexpr double ratio = 0.85;
+  const double stage_fp_rate =
+      fp_rate_ * (1 - ratio) *
+      std::pow(ratio, static_cast<double>(stages_.size()));
+  // The number of hashes which maximizes the capacity increases as the
+  // target false positive rate decreases: start from the one of the previous
+  // stage, and stop once the capacity decreases.
+  const auto blocks = std::ldexp(1.0, static_cast<int>(next_size_log2_) - 9);
+  uint64_t hashes = stages_.empty() ? 8 : stages_.back().hashes;
+  double keys_per_block = max_keys_per_block(stage_fp_rate, hashes);
+  while (hashes < 16) {
+    const auto n = max_keys_per_block(stage_fp_rate, hashes + 1);
+    if (n <= keys_per_block) {
+      break;
+    }
+    hashes++;
+    keys_per_block = n;
+  }
+  const auto capacity =
+      std::max<uint64_t>(static_cast<uint64_t>(keys_per_block * blocks), 1);
+  stages_.push_back(
+      {BloomFilter{next_size_log2_, hashes}, hashes, capacity, 0});
+  // The next filter is twice as large, up to the maximum size.
+  next_size_log2_ = std::min<uint64_t>(next_size_log2_ + 1, 40);
+}
+
+bool ScalableBloomFilter::insert(const uint64_t hash) {
+  for (const auto &stage : stages_) {
+    if (stage.filter.contains(hash)) {
+      return false;
+    }
+  }
+  auto &stage = stages_.back();
+  stage.filter.insert(hash);
+  if (++stage.count >= stage.capacity) {
+    grow();
+  }
+  return true;
+}
+
+uint64_t ScalableBloomFilter::filters() const noexcept {
+  return stages_.size();
+}
+
+uint64_t ScalableBloomFilter::size() const noexcept {
+  uint64_t size = 0;
+  for (const auto &stage : stages_) {
+    size += stage.filter.size();
+  }
+  return size;
+}
+
+}  // namespace caracal
@@ -1,5 +1,6 @@
 #include <caracal/checksum.hpp>
 #include <caracal/constants.hpp>
+#include <caracal/target_clones.hpp>
 
 namespace caracal::Checksum {
 
@@ -11,6 +12,7 @@ uint16_t caracal_checksum(uint32_t caracal_id, uint32_t dst_addr,
   return ip_checksum_finish(caracal_id + dst_addr + src_port + ttl);
 }
 
+CARACAL_TARGET_CLONES
 uint64_t ip_checksum_add(uint64_t sum, const void* data, size_t len) {
   // Sum 32-bit words
   auto data_32 = reinterpret_cast<const uint32_t*>(data);
@@ -0,0 +1,140 @@
+#include <arpa/inet.h>
+
+#include <caracal/bloom_filter.hpp>
+#include <caracal/feedback.hpp>
+#include <caracal/probe.hpp>
+#include <caracal/reply.hpp>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+namespace caracal {
+
+namespace {
+
+uint64_t hash_addr(const in6_addr &addr, const uint64_t seed) noexcept {
+  uint64_t words[2];
+  std::memcpy(words, &addr, sizeof(words));
+  return mix64(mix64(words[0] ^ seed) ^ words[1]);
+}
+
+in6_addr prefix(in6_addr addr) noexcept {
+  if (IN6_IS_ADDR_V4MAPPED(&addr)) {
+    addr.s6_addr32[3] &= htonl(~uint32_t{0}
+                               << (32 - Feedback::prefix_length_v4));
+  } else {
+    std::memset(addr.s6_addr + Feedback::prefix_length_v6 / 8, 0,
+                16 - Feedback::prefix_length_v6 / 8);
+  }
+  return addr;
+}
+
+uint16_t entry_tag(const uint64_t hash) noexcept {
+  // The tag 0 is reserved for the empty entries.
+  const auto tag = static_cast<uint16_t>(hash >> 48);
+  return tag ? tag : 1;
+}
+
+}  // namespace
+
+DestinationTable::DestinationTable(const uint64_t size_log2)
+    : mask_{0}, entries_{} {
+  if (size_log2 > 32) {
+    throw std::domain_error("Destination table size must be <= 2^32");
+  }
+  mask_ = (uint64_t{1} << size_log2) - 1;
+  entries_ = std::make_unique<std::atomic<uint32_t>[]>(mask_ + 1);
+}
+
+template <typename F>
+void DestinationTable::update(const in6_addr &addr, const uint32_t shift,
+                              const uint8_t ttl, F replace) noexcept {
+  const auto hash = hash_addr(addr, 0);
+  const uint32_t tag = entry_tag(hash);
+  auto &e = entries_[hash & mask_];
+  auto current = e.load(std::memory_order_relaxed);
+  uint32_t desired;
+  do {
+    if ((current >> 16) == tag) {
+      if (!replace(static_cast<uint8_t>(current >> shift), ttl)) {
+        return;
+      }
+      desired = (current & ~(uint32_t{0xFF} << shift)) |
+                (uint32_t{ttl} << shift);
+    } else {
+      // Evict the previous destination.
+      desired = (tag << 16) | (uint32_t{ttl} << shift);
+    }
+  } while (!e.compare_exchange_weak(current, desired,
+                                    std::memory_order_relaxed));
+}
+
+uint8_t DestinationTable::get(const in6_addr &addr,
+                              const uint32_t shift) const noexcept {
+  const auto hash = hash_addr(addr, 0);
+  const auto current = entries_[hash & mask_].load(std::memory_order_relaxed);
+  if ((current >> 16) != entry_tag(hash)) {
+    return 0;
+  }
+  return static_cast<uint8_t>(current >> shift);
+}
+
+void DestinationTable::raise_stop_ttl(const in6_addr &addr,
+                                      const uint8_t ttl) noexcept {
+  update(addr, stop_shift, ttl,
+         [](uint8_t current, uint8_t value) { return value > current; });
+}
+
+uint8_t DestinationTable::stop_ttl(const in6_addr &addr) const noexcept {
+  return get(addr, stop_shift);
+}
+
+void DestinationTable::lower_reached_ttl(const in6_addr &addr,
+                                         const uint8_t ttl) noexcept {
+  update(addr, reached_shift, ttl, [](uint8_t current, uint8_t value) {
+    return current == 0 || value < current;
+  });
+}
+
+uint8_t DestinationTable::reached_ttl(const in6_addr &addr) const noexcept {
+  return get(addr, reached_shift);
+}
+
+Feedback::Feedback(const uint64_t stop_set_size_log2,
+                   const uint64_t table_size_log2)
+    : stop_set_{stop_set_size_log2}, destinations_{table_size_log2} {}
+
+void Feedback::observe(const Reply &reply) noexcept {
+  if (IN6_ARE_ADDR_EQUAL(&reply.reply_src_addr, &reply.probe_dst_addr) &&
+      (reply.is_echo_reply() || reply.is_destination_unreachable())) {
+    destinations_.lower_reached_ttl(reply.probe_dst_addr, reply.probe_ttl);
+    return;
+  }
+  if (!reply.is_time_exceeded()) {
+    return;
+  }
+  // (interface, destination): ignore the repeated replies for the same
+  // destination (e.g. with n_packets > 1), so that a destination does not
+  // stop itself.
+  const auto interface = hash_addr(reply.reply_src_addr, 0);
+  if (!stop_set_.insert(hash_addr(reply.probe_dst_addr, interface))) {
+    return;
+  }
+  // (interface, prefix): the interface was already reached from another
+  // destination of the prefix.
+  if (!stop_set_.insert(
+          hash_addr(prefix(reply.probe_dst_addr), ~interface))) {
+    destinations_.raise_stop_ttl(reply.probe_dst_addr, reply.probe_ttl);
+  }
+}
+
+bool Feedback::stopped(const Probe &probe) const noexcept {
+  return probe.ttl < destinations_.stop_ttl(probe.dst_addr);
+}
+
+bool Feedback::reached(const Probe &probe) const noexcept {
+  const auto ttl = destinations_.reached_ttl(probe.dst_addr);
+  return ttl != 0 && probe.ttl > ttl;
+}
+
+}  // namespace caracal
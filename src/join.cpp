@@ -0,0 +1,373 @@
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/fmt/ostr.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <caracal/join.hpp>
+#include <caracal/pretty.hpp>
+#include <caracal/protocols.hpp>
+#include <cerrno>
+#include <compare>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::nanoseconds;
+
+namespace caracal::Join {
+
+namespace {
+
+// The runs are written as is to the temporary files.
+static_assert(std::is_trivially_copyable_v<Entry>);
+
+/// Number of entries read at once from a run.
+constexpr size_t run_buffer_size = 4096;
+
+/// Number of records read at once from an input file.
+constexpr size_t file_buffer_size = 65536;
+
+std::strong_ordering compare_probe(const Entry &a, const Entry &b) noexcept {
+  const auto c = std::memcmp(&a.dst_addr, &b.dst_addr, sizeof(in6_addr));
+  if (c != 0) {
+    return c <=> 0;
+  }
+  return std::tie(a.protocol, a.src_port, a.dst_port, a.ttl) <=>
+         std::tie(b.protocol, b.src_port, b.dst_port, b.ttl);
+}
+
+/// Call `f` with each record of `size` bytes of a file. A truncated last
+/// record (e.g. from a run that was killed) is ignored.
+template <typename F>
+void for_each_record(const fs::path &path, const size_t size, F &&f) {
+  std::ifstream ifs{path, std::ios::binary};
+  if (!ifs) {
+    throw std::system_error(errno, std::generic_category(), path.string());
+  }
+  std::vector<char> buffer(size * file_buffer_size);
+  uint64_t count = 0;
+  while (ifs) {
+    ifs.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    const auto n = static_cast<size_t>(ifs.gcount());
+    for (size_t offset = 0; offset + size <= n; offset += size) {
+      f(reinterpret_cast<const std::byte *>(buffer.data() + offset));
+    }
+    count += n / size;
+    if (n % size != 0) {
+      spdlog::warn("file={} truncated_bytes={}", path.string(), n % size);
+    }
+  }
+  spdlog::info("file={} records={}", path.string(), count);
+}
+
+}  // namespace
+
+Entry Entry::from_probe(const ProbeLog::Record &record) {
+  const auto &probe = record.probe;
+  const auto icmp = probe.protocol == Protocols::L4::ICMP ||
+                    probe.protocol == Protocols::L4::ICMPv6;
+  return Entry{.dst_addr = probe.dst_addr,
+               .protocol = Protocols::posix_value(probe.protocol),
+               .ttl = probe.ttl,
+               .src_port = probe.src_port,
+               .dst_port = icmp ? uint16_t{0} : probe.dst_port,
+               .timestamp = record.timestamp,
+               .sequence = record.sequence};
+}
+
+Entry Entry::from_reply(const Reply &reply) noexcept {
+  return Entry{.dst_addr = reply.probe_dst_addr,
+               .protocol = reply.probe_protocol,
+               .ttl = reply.probe_ttl,
+               .src_port = reply.probe_src_port,
+               .dst_port = reply.probe_dst_port,
+               .timestamp = microseconds{reply.capture_timestamp},
+               .sequence = 0};
+}
+
+bool Entry::same_probe(const Entry &other) const noexcept {
+  return compare_probe(*this, other) == 0;
+}
+
+bool Entry::operator<(const Entry &other) const noexcept {
+  const auto c = compare_probe(*this, other);
+  return c < 0 || (c == 0 && timestamp < other.timestamp);
+}
+
+/// A sorted run, written to a temporary file and read back in blocks.
+class ExternalSorter::Run {
+ public:
+  Run(const fs::path &path, const std::vector<Entry> &entries)
+      : path_{path}, buffer_(run_buffer_size), size_{0}, position_{0} {
+    std::ofstream ofs{path, std::ios::binary};
+    ofs.write(reinterpret_cast<const char *>(entries.data()),
+              static_cast<std::streamsize>(entries.size() * sizeof(Entry)));
+    if (!ofs) {
+      throw std::system_error(errno, std::generic_category(), path.string());
+    }
+  }
+
+  ~Run() {
+    std::error_code ec;
+    fs::remove(path_, ec);
+  }
+
+  Run(const Run &) = delete;
+  Run &operator=(const Run &) = delete;
+
+  /// Open the file and read the first entry.
+  bool open() {
+    stream_.open(path_, std::ios::binary);
+    if (!stream_) {
+      throw std::system_error(errno, std::generic_category(), path_.string());
+    }
+    return advance();
+  }
+
+  /// Move to the next entry.
+  /// @return false at the end of the run.
+  bool advance() {
+    if (++position_ < size_) {
+      return true;
+    }
+    stream_.read(reinterpret_cast<char *>(buffer_.data()),
+                 static_cast<std::streamsize>(buffer_.size() * sizeof(Entry)));
+    size_ = static_cast<size_t>(stream_.gcount()) / sizeof(Entry);
+    position_ = 0;
+    return size_ > 0;
+  }
+
+  [[nodiscard]] const Entry &current() const noexcept {
+    return buffer_[position_];
+  }
+
+ private:
+  fs::path path_;
+  std::ifstream stream_;
+  std::vector<Entry> buffer_;
+  size_t size_;
+  size_t position_;
+};
+
+ExternalSorter::ExternalSorter(const fs::path &directory,
+                               const size_t run_size)
+    : directory_{directory},
+      id_{std::random_device{}()},
+      run_size_{std::max<size_t>(run_size, 1)},
+      entries_{},
+      cursor_{0},
+      runs_{},
+      heap_{} {}
+
+ExternalSorter::~ExternalSorter() = default;
+
+void ExternalSorter::push(const Entry &entry) {
+  entries_.push_back(entry);
+  if (entries_.size() >= run_size_) {
+    write_run();
+  }
+}
+
+void ExternalSorter::write_run() {
+  std::sort(entries_.begin(), entries_.end());
+  const auto path = directory_ / fmt::format("caracal-join-{:016x}-{}.run",
+                                             id_, runs_.size());
+  runs_.push_back(std::make_unique<Run>(path, entries_));
+  entries_.clear();
+}
+
+void ExternalSorter::finish() {
+  // Everything fits in memory.
+  if (runs_.empty()) {
+    std::sort(entries_.begin(), entries_.end());
+    cursor_ = 0;
+    return;
+  }
+  if (!entries_.empty()) {
+    write_run();
+  }
+  entries_.shrink_to_fit();
+  heap_.clear();
+  for (size_t i = 0; i < runs_.size(); i++) {
+    if (runs_[i]->open()) {
+      heap_.push_back(i);
+    }
+  }
+  std::make_heap(heap_.begin(), heap_.end(), [this](size_t a, size_t b) {
+    return runs_[b]->current() < runs_[a]->current();
+  });
+}
+
+bool ExternalSorter::next(Entry &entry) {
+  if (runs_.empty()) {
+    if (cursor_ >= entries_.size()) {
+      return false;
+    }
+    entry = entries_[cursor_++];
+    return true;
+  }
+  if (heap_.empty()) {
+    return false;
+  }
+  const auto greater = [this](size_t a, size_t b) {
+    return runs_[b]->current() < runs_[a]->current();
+  };
+  std::pop_heap(heap_.begin(), heap_.end(), greater);
+  auto &run = *runs_[heap_.back()];
+  entry = run.current();
+  if (run.advance()) {
+    std::push_heap(heap_.begin(), heap_.end(), greater);
+  } else {
+    heap_.pop_back();
+  }
+  return true;
+}
+
+size_t ExternalSorter::runs() const noexcept { return runs_.size(); }
+
+std::string ProbeResult::csv_header() {
+  return "sequence,send_time,probe_protocol,probe_dst_addr,probe_src_port,"
+         "probe_dst_port,probe_ttl,replies,rtt";
+}
+
+std::string ProbeResult::to_csv() const {
+  return fmt::format(
+      "{},{},{},{},{},{},{},{},{}", probe.sequence, probe.timestamp.count(),
+      probe.protocol, probe.dst_addr, probe.src_port, probe.dst_port,
+      probe.ttl, replies,
+      rtt ? std::to_string(duration_cast<microseconds>(*rtt).count()) : "");
+}
+
+void Destination::add(const ProbeResult &result) noexcept {
+  probes++;
+  replies += result.replies;
+  if (result.rtt) {
+    answered++;
+    rtt_min = std::min(rtt_min, *result.rtt);
+    rtt_max = std::max(rtt_max, *result.rtt);
+    rtt_sum += *result.rtt;
+  }
+}
+
+double Destination::loss() const noexcept {
+  return probes > 0 ? static_cast<double>(probes - answered) / probes : 0;
+}
+
+std::string Destination::csv_header() {
+  return "probe_dst_addr,probes,answered,replies,loss,rtt_min,rtt_avg,rtt_max";
+}
+
+std::string Destination::to_csv() const {
+  if (answered == 0) {
+    return fmt::format("{},{},{},{},{:.3f},,,", dst_addr, probes, answered,
+                       replies, loss());
+  }
+  return fmt::format("{},{},{},{},{:.3f},{},{},{}", dst_addr, probes, answered,
+                     replies, loss(),
+                     duration_cast<microseconds>(rtt_min).count(),
+                     duration_cast<microseconds>(rtt_sum / answered).count(),
+                     duration_cast<microseconds>(rtt_max).count());
+}
+
+std::ostream &operator<<(std::ostream &os, Summary const &v) {
+  os << "join_probes=" << v.probes;
+  os << " join_answered=" << v.answered;
+  os << " join_replies=" << v.replies;
+  os << " join_unmatched_replies=" << v.unmatched_replies;
+  return os;
+}
+
+Summary join(const std::vector<fs::path> &probe_logs,
+             const std::vector<fs::path> &reply_files, const Options &options,
+             const std::function<void(const Destination &)> &on_destination,
+             const std::function<void(const ProbeResult &)> &on_probe) {
+  ExternalSorter probes{options.temp_directory, options.run_size};
+  for (const auto &path : probe_logs) {
+    for_each_record(path, ProbeLog::Record::binary_size,
+                    [&](const std::byte *data) {
+                      probes.push(Entry::from_probe(
+                          ProbeLog::Record::from_binary(data)));
+                    });
+  }
+  probes.finish();
+
+  ExternalSorter replies{options.temp_directory, options.run_size};
+  for (const auto &path : reply_files) {
+    for_each_record(path, Reply::binary_size, [&](const std::byte *data) {
+      replies.push(Entry::from_reply(Reply::from_binary(data)));
+    });
+  }
+  replies.finish();
+  spdlog::info("probe_runs={} reply_runs={}", probes.runs(), replies.runs());
+
+  // Merge the two sorted streams, one probe (destination, flow and TTL) at a
+  // time: the same probe may have been sent multiple times.
+  Summary summary{};
+  std::optional<Destination> destination;
+  std::vector<ProbeResult> group;
+  Entry probe{};
+  Entry reply{};
+  bool has_probe = probes.next(probe);
+  bool has_reply = replies.next(reply);
+  while (has_probe) {
+    group.clear();
+    group.push_back({probe, 0, std::nullopt});
+    while ((has_probe = probes.next(probe)) &&
+           probe.same_probe(group.front().probe)) {
+      group.push_back({probe, 0, std::nullopt});
+    }
+    const auto &key = group.front().probe;
+    while (has_reply && compare_probe(reply, key) < 0) {
+      summary.unmatched_replies++;
+      has_reply = replies.next(reply);
+    }
+    // Both are sorted by time: the matching probe only moves forward.
+    size_t i = 0;
+    while (has_reply && reply.same_probe(key)) {
+      while (i + 1 < group.size() &&
+             group[i + 1].probe.timestamp <= reply.timestamp) {
+        i++;
+      }
+      auto &result = group[i];
+      result.replies++;
+      if (!result.rtt) {
+        result.rtt = std::max(nanoseconds{0},
+                              reply.timestamp - result.probe.timestamp);
+      }
+      has_reply = replies.next(reply);
+    }
+    if (destination &&
+        !IN6_ARE_ADDR_EQUAL(&destination->dst_addr, &key.dst_addr)) {
+      on_destination(*destination);
+      destination.reset();
+    }
+    if (!destination) {
+      destination.emplace();
+      destination->dst_addr = key.dst_addr;
+    }
+    for (const auto &result : group) {
+      destination->add(result);
+      summary.probes++;
+      summary.answered += result.rtt ? 1 : 0;
+      summary.replies += result.replies;
+      if (on_probe) {
+        on_probe(result);
+      }
+    }
+  }
+  if (destination) {
+    on_destination(*destination);
+  }
+  while (has_reply) {
+    summary.unmatched_replies++;
+    has_reply = replies.next(reply);
+  }
+  return summary;
+}
+
+}  // namespace caracal::Join
@@ -0,0 +1,217 @@
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <caracal/mda.hpp>
+#include <caracal/probe.hpp>
+#include <caracal/prober.hpp>
+#include <caracal/prober_session.hpp>
+#include <caracal/reply.hpp>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace caracal::MDA {
+
+uint64_t stopping_point(const uint64_t n_interfaces, const double epsilon) {
+  // Hypothesis: there are k = n + 1 interfaces.
+  const auto k = static_cast<double>(std::max<uint64_t>(n_interfaces, 1) + 1);
+  return static_cast<uint64_t>(
+      std::ceil(std::log(epsilon / k) / std::log((k - 1) / k)));
+}
+
+Engine::Engine(const std::vector<in6_addr> &destinations,
+               const uint8_t min_ttl, const uint8_t max_ttl,
+               const Protocols::L4 protocol, const double epsilon,
+               std::shared_ptr<ReplySink> next)
+    : min_ttl_{min_ttl},
+      max_ttl_{max_ttl},
+      protocol_{protocol},
+      stopping_points_{},
+      next_{std::move(next)},
+      destinations_{},
+      index_{} {
+  if (min_ttl == 0 || min_ttl > max_ttl) {
+    throw std::invalid_argument("min_ttl must be > 0 and <= max_ttl");
+  }
+  if (epsilon <= 0 || epsilon >= 1) {
+    throw std::domain_error("epsilon must be in ]0, 1[");
+  }
+
+  // Pre-compute the stopping points until they exceed the number of flows.
+  for (uint64_t n = 0;; n++) {
+    const auto flows = std::min(stopping_point(n, epsilon), max_flows);
+    stopping_points_.push_back(static_cast<uint16_t>(flows));
+    if (flows == max_flows) {
+      break;
+    }
+  }
+
+  destinations_.reserve(destinations.size());
+  index_.reserve(destinations.size());
+  for (const auto &addr : destinations) {
+    if (index_.try_emplace(addr, destinations_.size()).second) {
+      destinations_.push_back(
+          {addr, 0, std::vector<uint16_t>(max_ttl - min_ttl + 1, 0), {}});
+    }
+  }
+}
+
+void Engine::write(const Reply &reply, const std::string &round) {
+  {
+    std::scoped_lock lock{mutex_};
+    const auto it = index_.find(reply.probe_dst_addr);
+    if (it != index_.end() && reply.probe_ttl >= min_ttl_ &&
+        reply.probe_ttl <= max_ttl_) {
+      auto &destination = destinations_[it->second];
+      auto &interfaces = destination.interfaces;
+      const auto found = std::any_of(
+          interfaces.begin(), interfaces.end(), [&](const Interface &i) {
+            return i.ttl == reply.probe_ttl &&
+                   IN6_ARE_ADDR_EQUAL(&i.addr, &reply.reply_src_addr);
+          });
+      if (!found) {
+        interfaces.push_back({reply.reply_src_addr, reply.probe_ttl});
+      }
+      const auto reached =
+          IN6_ARE_ADDR_EQUAL(&reply.reply_src_addr, &reply.probe_dst_addr) &&
+          (reply.is_echo_reply() || reply.is_destination_unreachable());
+      if (reached && (destination.reached_ttl == 0 ||
+                      reply.probe_ttl < destination.reached_ttl)) {
+        destination.reached_ttl = reply.probe_ttl;
+      }
+    }
+  }
+  if (next_) {
+    next_->write(reply, round);
+  }
+}
+
+void Engine::flush() {
+  if (next_) {
+    next_->flush();
+  }
+}
+
+std::vector<Probe> Engine::next_round() {
+  std::scoped_lock lock{mutex_};
+  std::vector<Probe> probes;
+  std::vector<uint64_t> counts(max_ttl_ - min_ttl_ + 1);
+
+  for (auto &destination : destinations_) {
+    // Do not probe beyond the destination.
+    const auto max_ttl =
+        destination.reached_ttl ? destination.reached_ttl : max_ttl_;
+
+    std::fill(counts.begin(), counts.end(), 0);
+    for (const auto &interface : destination.interfaces) {
+      counts[interface.ttl - min_ttl_]++;
+    }
+
+    for (uint8_t ttl = min_ttl_; ttl <= max_ttl; ttl++) {
+      const auto n_interfaces = std::min<uint64_t>(
+          counts[ttl - min_ttl_], stopping_points_.size() - 1);
+      const auto target = stopping_points_[n_interfaces];
+      auto &flows = destination.flows[ttl - min_ttl_];
+      for (; flows < target; flows++) {
+        probes.push_back({destination.addr,
+                          static_cast<uint16_t>(src_port + flows), dst_port,
+                          ttl, protocol_, 0, 0});
+      }
+      // Avoid overflowing `ttl` when max_ttl == 255.
+      if (ttl == UINT8_MAX) {
+        break;
+      }
+    }
+  }
+
+  return probes;
+}
+
+const Engine::Destination *Engine::find(const in6_addr &addr) const {
+  const auto it = index_.find(addr);
+  if (it == index_.end()) {
+    return nullptr;
+  }
+  return &destinations_[it->second];
+}
+
+uint64_t Engine::flows(const in6_addr &destination, const uint8_t ttl) const {
+  std::scoped_lock lock{mutex_};
+  const auto d = find(destination);
+  if (!d || ttl < min_ttl_ || ttl > max_ttl_) {
+    return 0;
+  }
+  return d->flows[ttl - min_ttl_];
+}
+
+std::vector<in6_addr> Engine::interfaces(const in6_addr &destination,
+                                         const uint8_t ttl) const {
+  std::scoped_lock lock{mutex_};
+  std::vector<in6_addr> interfaces;
+  if (const auto d = find(destination)) {
+    for (const auto &interface : d->interfaces) {
+      if (interface.ttl == ttl) {
+        interfaces.push_back(interface.addr);
+      }
+    }
+  }
+  return interfaces;
+}
+
+namespace {
+
+/// Send the replies of a session to `sink`, and restore its previous sink on
+/// destruction (e.g. if a round throws).
+class ScopedSink {
+ public:
+  ScopedSink(Prober::Session &session, std::shared_ptr<ReplySink> sink)
+      : session_{session}, previous_{session.sink()} {
+    session_.set_sink(std::move(sink));
+  }
+
+  ~ScopedSink() {
+    try {
+      session_.set_sink(previous_);
+    } catch (const std::exception &e) {
+      spdlog::warn("error=set_sink: {}", e.what());
+    }
+  }
+
+  ScopedSink(const ScopedSink &) = delete;
+  ScopedSink &operator=(const ScopedSink &) = delete;
+
+ private:
+  Prober::Session &session_;
+  std::shared_ptr<ReplySink> previous_;
+};
+
+}  // namespace
+
+uint64_t run(Prober::Session &session, const std::shared_ptr<Engine> &engine,
+             const uint64_t max_rounds) {
+  const ScopedSink sink{session, engine};
+  uint64_t round = 0;
+  while (round < max_rounds) {
+    const auto probes = engine->next_round();
+    if (probes.empty()) {
+      break;
+    }
+    round++;
+    spdlog::info("mda_round={} probes={}", round, probes.size());
+    Prober::Iterator it = [&probes, i = size_t{0}](Probe &p) mutable {
+      if (i == probes.size()) {
+        return false;
+      }
+      p = probes[i++];
+      return true;
+    };
+    session.run(it, std::to_string(round));
+  }
+  return round;
+}
+
+}  // namespace caracal::MDA
@@ -18,62 +18,16 @@ Packet::Packet(std::byte* buffer, const size_t buffer_len,
     : l2_protocol_{l2_protocol},
       l3_protocol_{l3_protocol},
       l4_protocol_{l4_protocol} {
-  size_t l2_header_size;
-  size_t l3_header_size;
-  size_t l4_header_size;
-
-  // Pad the beginning of the packet to align on a four-byte boundary.
-  // See https://lwn.net/Articles/89597/.
-  size_t padding;
-
-  switch (l2_protocol) {
-    case Protocols::L2::BSDLoopback:
-      l2_header_size = sizeof(uint32_t);
-      padding = 0;
-      break;
-
-    case Protocols::L2::Ethernet:
-      l2_header_size = sizeof(ether_header);
-      padding = 2;
-      break;
-
-    case Protocols::L2::None:
-      l2_header_size = 0;
-      padding = 0;
-      break;
-  }
-
-  switch (l3_protocol) {
-    case Protocols::L3::IPv4:
-      l3_header_size = sizeof(ip);
-      break;
-
-    case Protocols::L3::IPv6:
-      l3_header_size = sizeof(ip6_hdr);
-      break;
-  }
-
-  switch (l4_protocol) {
-    case Protocols::L4::ICMP:
-      l4_header_size = ICMP_HEADER_SIZE;
-      break;
-
-    case Protocols::L4::ICMPv6:
-      l4_header_size = ICMPV6_HEADER_SIZE;
-      break;
-
-    case Protocols::L4::UDP:
-      l4_header_size = sizeof(udphdr);
-      break;
-  }
-
   begin_ = buffer;
-  l2_ = begin_ + padding;
-  l3_ = l2_ + l2_header_size;
-  l4_ = l3_ + l3_header_size;
-  payload_ = l4_ + l4_header_size;
+  l2_ = begin_ + padding_size(l2_protocol);
+  l3_ = l2_ + header_size(l2_protocol);
+  l4_ = l3_ + header_size(l3_protocol);
+  payload_ = l4_ + header_size(l4_protocol);
   end_ = payload_ + payload_size;
+  check_size(buffer_len);
+}
 
+void Packet::check_size(const size_t buffer_len) const {
   if (buffer_len < static_cast<uint64_t>(end_ - begin_)) {
     throw std::invalid_argument{"Packet buffer is too small"};
   }
@@ -1,14 +1,23 @@
 #include <sys/types.h>
 #include <netinet/in.h>
 #include <netinet/ip.h>
+#include <netinet/ip6.h>
+#include <netinet/ip_icmp.h>
 #include <netinet/udp.h>
 #include <tins/tins.h>
 
+// Must be included after netinet/ip.h on macOS.
+#include <netinet/icmp6.h>
+
 #include <caracal/constants.hpp>
 #include <caracal/parser.hpp>
 #include <caracal/reply.hpp>
+#include <caracal/target_clones.hpp>
 #include <caracal/timestamp.hpp>
 #include <chrono>
+#include <cstring>
+#include <exception>
+#include <memory>
 #include <optional>
 
 using Tins::PDU;
@@ -137,6 +146,59 @@ void parse_inner_ttl_icmp(Reply& reply, const Tins::IPv6* ip) noexcept {
       ip->payload_length() - ICMPV6_HEADER_SIZE - PAYLOAD_TWEAK_BYTES;
 }
 
+optional<Probe> parse_probe(const std::byte* data, const size_t size) noexcept {
+  Probe probe{};
+  size_t l4_offset = 0;
+  uint8_t protocol = 0;
+  if (size >= sizeof(ip_hdr) && (std::to_integer<uint8_t>(data[0]) >> 4) == 4) {
+    ip_hdr ip_header{};
+    std::memcpy(&ip_header, data, sizeof(ip_header));
+    probe.dst_addr.s6_addr32[2] = htonl(0x0000FFFFU);
+    probe.dst_addr.s6_addr32[3] = ip_header.ip_dst.s_addr;
+    probe.ttl = ip_header.ip_ttl;
+    protocol = ip_header.ip_p;
+    l4_offset = ip_header.ip_hl * 4;
+  } else if (size >= sizeof(ip6_hdr) &&
+             (std::to_integer<uint8_t>(data[0]) >> 4) == 6) {
+    ip6_hdr ip_header{};
+    std::memcpy(&ip_header, data, sizeof(ip_header));
+    probe.dst_addr = ip_header.ip6_dst;
+    probe.ttl = ip_header.ip6_hlim;
+    probe.flow_label = ntohl(ip_header.ip6_flow) & 0xFFFFFU;
+    protocol = ip_header.ip6_nxt;
+    l4_offset = sizeof(ip6_hdr);
+  } else {
+    return nullopt;
+  }
+
+  // The source port is encoded in the ICMP identifier (bytes 4-5), and the
+  // UDP ports are the first 4 bytes of the header.
+  if (size < l4_offset + 8) {
+    return nullopt;
+  }
+  uint16_t words[4];
+  std::memcpy(words, data + l4_offset, sizeof(words));
+  switch (protocol) {
+    case IPPROTO_ICMP:
+      probe.protocol = Protocols::L4::ICMP;
+      probe.src_port = ntohs(words[2]);
+      break;
+    case IPPROTO_ICMPV6:
+      probe.protocol = Protocols::L4::ICMPv6;
+      probe.src_port = ntohs(words[2]);
+      break;
+    case IPPROTO_UDP:
+      probe.protocol = Protocols::L4::UDP;
+      probe.src_port = ntohs(words[0]);
+      probe.dst_port = ntohs(words[1]);
+      break;
+    default:
+      return nullopt;
+  }
+  return probe;
+}
+
+CARACAL_TARGET_CLONES
 optional<Reply> parse(const Tins::Packet& packet) noexcept {
   const PDU* pdu = packet.pdu();
   if (!pdu) {
@@ -244,4 +306,41 @@ optional<Reply> parse(const Tins::Packet& packet) noexcept {
   return nullopt;
 }
 
+namespace {
+
+/// Dissect a frame according to its link type, as Tins::Sniffer does.
+std::unique_ptr<PDU> make_pdu(const int link_type, const u_char* data,
+                              const uint32_t size) {
+  switch (link_type) {
+    case DLT_EN10MB:
+      return std::make_unique<Tins::EthernetII>(data, size);
+    case DLT_NULL:
+      return std::make_unique<Tins::Loopback>(data, size);
+    case DLT_LINUX_SLL:
+      return std::make_unique<Tins::SLL>(data, size);
+    case DLT_RAW:
+      if (size > 0 && (data[0] >> 4) == 6) {
+        return std::make_unique<Tins::IPv6>(data, size);
+      }
+      return std::make_unique<Tins::IP>(data, size);
+    default:
+      return std::make_unique<RawPDU>(data, size);
+  }
+}
+
+}  // namespace
+
+optional<Reply> parse(const int link_type, const pcap_pkthdr& header,
+                      const u_char* data) noexcept {
+  try {
+    const Tins::Packet packet{make_pdu(link_type, data, header.caplen).release(),
+                              Tins::Timestamp{header.ts},
+                              Tins::Packet::own_pdu{}};
+    return parse(packet);
+  } catch (const std::exception&) {
+    // Malformed frame.
+    return nullopt;
+  }
+}
+
 }  // namespace caracal::Parser
@@ -0,0 +1,274 @@
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+
+#ifdef CARACAL_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#include <algorithm>
+#include <bit>
+#include <caracal/pcap_writer.hpp>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+using std::chrono::steady_clock;
+
+namespace caracal {
+
+namespace {
+
+/// The pcap file header, written in host byte order (the readers detect the
+/// byte order from the magic number), with microsecond timestamps.
+struct FileHeader {
+  uint32_t magic = 0xa1b2c3d4;
+  uint16_t version_major = 2;
+  uint16_t version_minor = 4;
+  int32_t thiszone = 0;
+  uint32_t sigfigs = 0;
+  uint32_t snaplen;
+  uint32_t link_type;
+};
+
+/// The pcap record header, followed by `caplen` bytes of data. The records
+/// are stored with the same layout in the ring buffer.
+struct RecordHeader {
+  uint32_t ts_sec;
+  uint32_t ts_usec;
+  uint32_t caplen;
+  uint32_t len;
+};
+
+static_assert(sizeof(FileHeader) == 24);
+static_assert(sizeof(RecordHeader) == 16);
+
+void copy_in(std::vector<std::byte> &buffer, const uint64_t mask,
+             const uint64_t position, const void *data, const size_t size) {
+  const auto offset = position & mask;
+  const auto first = std::min<size_t>(size, buffer.size() - offset);
+  std::memcpy(buffer.data() + offset, data, first);
+  std::memcpy(buffer.data(), static_cast<const std::byte *>(data) + first,
+              size - first);
+}
+
+void copy_out(const std::vector<std::byte> &buffer, const uint64_t mask,
+              const uint64_t position, void *data, const size_t size) {
+  const auto offset = position & mask;
+  const auto first = std::min<size_t>(size, buffer.size() - offset);
+  std::memcpy(data, buffer.data() + offset, first);
+  std::memcpy(static_cast<std::byte *>(data) + first, buffer.data(),
+              size - first);
+}
+
+}  // namespace
+
+/// An output file, optionally compressed.
+class PcapWriter::File {
+ public:
+  File(const fs::path &path, const bool zstd)
+      : stream_{path, std::ios::binary}, size_{0} {
+    if (!stream_) {
+      throw std::system_error(errno, std::generic_category(), path.string());
+    }
+#ifdef CARACAL_WITH_ZSTD
+    if (zstd) {
+      context_ = ZSTD_createCCtx();
+      output_.resize(ZSTD_CStreamOutSize());
+    }
+#else
+    (void)zstd;
+#endif
+  }
+
+  ~File() {
+#ifdef CARACAL_WITH_ZSTD
+    if (context_) {
+      try {
+        compress(nullptr, 0, ZSTD_e_end);
+      } catch (const std::exception &e) {
+        spdlog::error("pcap_writer error={}", e.what());
+      }
+      ZSTD_freeCCtx(context_);
+    }
+#endif
+  }
+
+  File(const File &) = delete;
+  File &operator=(const File &) = delete;
+
+  void write(const void *data, const size_t size) {
+    size_ += size;
+#ifdef CARACAL_WITH_ZSTD
+    if (context_) {
+      compress(data, size, ZSTD_e_continue);
+      return;
+    }
+#endif
+    stream_.write(static_cast<const char *>(data),
+                  static_cast<std::streamsize>(size));
+  }
+
+  /// Number of bytes written, before compression.
+  [[nodiscard]] uint64_t size() const noexcept { return size_; }
+
+  [[nodiscard]] bool good() const noexcept { return stream_.good(); }
+
+ private:
+#ifdef CARACAL_WITH_ZSTD
+  void compress(const void *data, const size_t size,
+                const ZSTD_EndDirective directive) {
+    ZSTD_inBuffer input{data, size, 0};
+    size_t remaining = 0;
+    do {
+      ZSTD_outBuffer output{output_.data(), output_.size(), 0};
+      remaining = ZSTD_compressStream2(context_, &output, &input, directive);
+      if (ZSTD_isError(remaining)) {
+        throw std::runtime_error(ZSTD_getErrorName(remaining));
+      }
+      stream_.write(output_.data(), static_cast<std::streamsize>(output.pos));
+    } while (directive == ZSTD_e_end ? remaining > 0
+                                     : input.pos < input.size);
+  }
+
+  ZSTD_CCtx *context_ = nullptr;
+  std::vector<char> output_;
+#endif
+  std::ofstream stream_;
+  uint64_t size_;
+};
+
+PcapWriter::PcapWriter(const fs::path &prefix, const int link_type,
+                       const Options &options)
+    : prefix_{prefix},
+      link_type_{link_type},
+      options_{options},
+      buffer_(std::bit_ceil(std::max<uint64_t>(
+          options.buffer_size,
+          sizeof(RecordHeader) + options.snaplen))),
+      mask_{buffer_.size() - 1},
+      head_{0},
+      dropped_{0},
+      tail_{0},
+      written_{0},
+      files_count_{0},
+      stopped_{false},
+      file_{},
+      file_opened_{} {
+#ifndef CARACAL_WITH_ZSTD
+  if (options.zstd) {
+    throw std::invalid_argument(
+        "zstd compression requires a build with WITH_ZSTD");
+  }
+#endif
+  thread_ = std::thread([this]() { run(); });
+}
+
+PcapWriter::~PcapWriter() {
+  stopped_ = true;
+  thread_.join();
+}
+
+bool PcapWriter::write(const pcap_pkthdr &header,
+                       const u_char *data) noexcept {
+  const auto caplen = std::min(header.caplen, options_.snaplen);
+  const auto size = sizeof(RecordHeader) + caplen;
+  const auto head = head_.load(std::memory_order_relaxed);
+  if (head + size - tail_.load(std::memory_order_acquire) > buffer_.size()) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  const RecordHeader record{static_cast<uint32_t>(header.ts.tv_sec),
+                            static_cast<uint32_t>(header.ts.tv_usec), caplen,
+                            header.len};
+  copy_in(buffer_, mask_, head, &record, sizeof(record));
+  copy_in(buffer_, mask_, head + sizeof(record), data, caplen);
+  head_.store(head + size, std::memory_order_release);
+  return true;
+}
+
+void PcapWriter::run() {
+  std::vector<std::byte> frame(options_.snaplen);
+  try {
+    while (true) {
+      const auto head = head_.load(std::memory_order_acquire);
+      auto tail = tail_.load(std::memory_order_relaxed);
+      if (tail == head) {
+        if (stopped_) {
+          break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        continue;
+      }
+      while (tail != head) {
+        RecordHeader record{};
+        copy_out(buffer_, mask_, tail, &record, sizeof(record));
+        copy_out(buffer_, mask_, tail + sizeof(record), frame.data(),
+                 record.caplen);
+        if (!file_ ||
+            (options_.rotate_size > 0 &&
+             file_->size() >= options_.rotate_size) ||
+            (options_.rotate_interval.count() > 0 &&
+             steady_clock::now() - file_opened_ >= options_.rotate_interval)) {
+          rotate();
+        }
+        file_->write(&record, sizeof(record));
+        file_->write(frame.data(), record.caplen);
+        tail += sizeof(record) + record.caplen;
+        tail_.store(tail, std::memory_order_release);
+        written_.fetch_add(1, std::memory_order_relaxed);
+      }
+      if (!file_->good()) {
+        throw std::runtime_error("cannot write " +
+                                 file_path(prefix_, files_count_ - 1,
+                                           options_.zstd)
+                                     .string());
+      }
+    }
+    file_.reset();
+  } catch (const std::exception &e) {
+    // The capture goes on, the frames are dropped once the buffer is full.
+    spdlog::error("pcap_writer error={}", e.what());
+  }
+}
+
+void PcapWriter::rotate() {
+  const auto n = files_count_.load(std::memory_order_relaxed);
+  const auto path = file_path(prefix_, n, options_.zstd);
+  file_.reset();
+  file_ = std::make_unique<File>(path, options_.zstd);
+  file_opened_ = steady_clock::now();
+  const FileHeader header{.snaplen = options_.snaplen,
+                          .link_type = static_cast<uint32_t>(link_type_)};
+  file_->write(&header, sizeof(header));
+  files_count_.store(n + 1, std::memory_order_relaxed);
+  spdlog::info("pcap_file={}", path.string());
+}
+
+uint64_t PcapWriter::written() const noexcept {
+  return written_.load(std::memory_order_relaxed);
+}
+
+uint64_t PcapWriter::dropped() const noexcept {
+  return dropped_.load(std::memory_order_relaxed);
+}
+
+std::vector<fs::path> PcapWriter::files() const {
+  std::vector<fs::path> files;
+  for (uint64_t n = 0; n < files_count_; n++) {
+    files.push_back(file_path(prefix_, n, options_.zstd));
+  }
+  return files;
+}
+
+fs::path PcapWriter::file_path(const fs::path &prefix, const uint64_t n,
+                               const bool zstd) {
+  return fmt::format("{}-{:06}.pcap{}", prefix.string(), n,
+                     zstd ? ".zst" : "");
+}
+
+}  // namespace caracal
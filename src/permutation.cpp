@@ -0,0 +1,44 @@
+#include <caracal/bloom_filter.hpp>
+#include <caracal/permutation.hpp>
+#include <stdexcept>
+
+namespace caracal {
+
+Permutation::Permutation(const uint64_t size, const uint64_t key)
+    : size_{size}, half_bits_{1}, half_mask_{0}, keys_{} {
+  if (size == 0) {
+    throw std::domain_error("Permutation size must be > 0");
+  }
+  // Smallest even number of bits covering the domain: the Feistel domain is
+  // at most 4 times larger, so cycle-walking takes < 4 iterations on average.
+  while (half_bits_ < 32 && (uint64_t{1} << (2 * half_bits_)) < size) {
+    half_bits_++;
+  }
+  half_mask_ = (uint64_t{1} << half_bits_) - 1;
+  for (int i = 0; i < rounds; i++) {
+    keys_[i] = mix64(key + static_cast<uint64_t>(i) * 0x9e3779b97f4a7c15ULL);
+  }
+}
+
+uint64_t Permutation::feistel(const uint64_t x) const noexcept {
+  uint64_t left = x >> half_bits_;
+  uint64_t right = x & half_mask_;
+  for (const auto key : keys_) {
+    const uint64_t next = left ^ (mix64(right ^ key) & half_mask_);
+    left = right;
+    right = next;
+  }
+  return (left << half_bits_) | right;
+}
+
+uint64_t Permutation::operator()(const uint64_t i) const noexcept {
+  auto x = feistel(i);
+  while (x >= size_) {
+    x = feistel(x);
+  }
+  return x;
+}
+
+uint64_t Permutation::size() const noexcept { return size_; }
+
+}  // namespace caracal
@@ -7,6 +7,7 @@
 #include <caracal/constants.hpp>
 #include <caracal/probe.hpp>
 #include <caracal/utilities.hpp>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -59,6 +60,38 @@ std::string Probe::to_csv() const noexcept {
                      Protocols::to_string(protocol), flow_label, wait_us);
 }
 
+Probe Probe::from_binary(const std::byte *data) {
+  Probe probe{};
+  uint16_t u16;
+  uint32_t u32;
+  std::memcpy(&probe.dst_addr, data, sizeof(in6_addr));
+  std::memcpy(&u16, data + 16, sizeof(u16));
+  probe.src_port = ntohs(u16);
+  std::memcpy(&u16, data + 18, sizeof(u16));
+  probe.dst_port = ntohs(u16);
+  probe.ttl = std::to_integer<uint8_t>(data[20]);
+  probe.protocol = Protocols::l4_from_posix(std::to_integer<uint8_t>(data[21]));
+  std::memcpy(&u32, data + 22, sizeof(u32));
+  probe.flow_label = ntohl(u32);
+  std::memcpy(&u32, data + 26, sizeof(u32));
+  probe.wait_us = ntohl(u32);
+  return probe;
+}
+
+void Probe::to_binary(std::byte *data) const noexcept {
+  const uint16_t src_port_n = htons(src_port);
+  const uint16_t dst_port_n = htons(dst_port);
+  const uint32_t flow_label_n = htonl(flow_label);
+  const uint32_t wait_us_n = htonl(wait_us);
+  std::memcpy(data, &dst_addr, sizeof(in6_addr));
+  std::memcpy(data + 16, &src_port_n, sizeof(src_port_n));
+  std::memcpy(data + 18, &dst_port_n, sizeof(dst_port_n));
+  data[20] = std::byte{ttl};
+  data[21] = std::byte{Protocols::posix_value(protocol)};
+  std::memcpy(data + 22, &flow_label_n, sizeof(flow_label_n));
+  std::memcpy(data + 26, &wait_us_n, sizeof(wait_us_n));
+}
+
 bool Probe::operator==(const Probe &other) const noexcept {
   return IN6_ARE_ADDR_EQUAL(&dst_addr, &other.dst_addr) &&
          (src_port == other.src_port) && (dst_port == other.dst_port) &&
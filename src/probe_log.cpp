@@ -0,0 +1,136 @@
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <bit>
+#include <caracal/probe_log.hpp>
+#include <cerrno>
+#include <system_error>
+#include <thread>
+
+namespace caracal {
+
+namespace {
+
+void put_u64(std::byte *data, const uint64_t value) noexcept {
+  for (size_t i = 0; i < 8; i++) {
+    data[i] = static_cast<std::byte>(value >> (8 * (7 - i)));
+  }
+}
+
+uint64_t get_u64(const std::byte *data) noexcept {
+  uint64_t value = 0;
+  for (size_t i = 0; i < 8; i++) {
+    value = (value << 8) | std::to_integer<uint64_t>(data[i]);
+  }
+  return value;
+}
+
+/// Number of records serialized before each write to the file.
+constexpr size_t batch_size = 4096;
+
+}  // namespace
+
+ProbeLog::Record ProbeLog::Record::from_binary(const std::byte *data) {
+  Record record{};
+  record.sequence = get_u64(data);
+  record.timestamp =
+      std::chrono::nanoseconds{static_cast<int64_t>(get_u64(data + 8))};
+  record.probe = Probe::from_binary(data + 16);
+  return record;
+}
+
+void ProbeLog::Record::to_binary(std::byte *data) const noexcept {
+  put_u64(data, sequence);
+  put_u64(data + 8, static_cast<uint64_t>(timestamp.count()));
+  probe.to_binary(data + 16);
+  data[16 + Probe::binary_size] = std::byte{0};
+  data[16 + Probe::binary_size + 1] = std::byte{0};
+}
+
+ProbeLog::ProbeLog(const fs::path &path, const size_t capacity)
+    : path_{path},
+      stream_{},
+      buffer_(std::bit_ceil(std::max<size_t>(capacity, 1))),
+      mask_{buffer_.size() - 1},
+      sequence_{0},
+      head_{0},
+      dropped_{0},
+      tail_{0},
+      written_{0},
+      stopped_{false} {
+  // Continue the sequence of the previous runs, after dropping the partial
+  // record of an interrupted run.
+  if (fs::exists(path)) {
+    sequence_ = fs::file_size(path) / Record::binary_size;
+    fs::resize_file(path, sequence_ * Record::binary_size);
+  }
+  stream_.open(path, std::ios::binary | std::ios::app);
+  if (!stream_) {
+    throw std::system_error(errno, std::generic_category(), path.string());
+  }
+  spdlog::info("probe_log={} probe_log_sequence={}", path.string(), sequence_);
+  thread_ = std::thread([this]() { run(); });
+}
+
+ProbeLog::~ProbeLog() {
+  stopped_ = true;
+  thread_.join();
+}
+
+bool ProbeLog::write(const Probe &probe,
+                     const std::chrono::nanoseconds timestamp) noexcept {
+  const auto sequence = sequence_++;
+  const auto head = head_.load(std::memory_order_relaxed);
+  if (head - tail_.load(std::memory_order_acquire) == buffer_.size()) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  buffer_[head & mask_] = Record{sequence, timestamp, probe};
+  head_.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+void ProbeLog::run() {
+  std::vector<std::byte> output(batch_size * Record::binary_size);
+  while (true) {
+    const auto head = head_.load(std::memory_order_acquire);
+    auto tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head) {
+      if (stopped_) {
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+    while (tail != head) {
+      const auto count = std::min<uint64_t>(head - tail, batch_size);
+      for (uint64_t i = 0; i < count; i++) {
+        buffer_[(tail + i) & mask_].to_binary(output.data() +
+                                              i * Record::binary_size);
+      }
+      // The slots can be reused before the disk write.
+      tail += count;
+      tail_.store(tail, std::memory_order_release);
+      stream_.write(reinterpret_cast<const char *>(output.data()),
+                    static_cast<std::streamsize>(count * Record::binary_size));
+      if (!stream_) {
+        // The probing goes on, the records are dropped once the buffer is
+        // full.
+        spdlog::error("probe_log error=cannot write {}", path_.string());
+        return;
+      }
+      written_.fetch_add(count, std::memory_order_relaxed);
+    }
+  }
+  stream_.flush();
+}
+
+uint64_t ProbeLog::written() const noexcept {
+  return written_.load(std::memory_order_relaxed);
+}
+
+uint64_t ProbeLog::dropped() const noexcept {
+  return dropped_.load(std::memory_order_relaxed);
+}
+
+}  // namespace caracal
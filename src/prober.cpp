@@ -1,166 +1,345 @@
+#include <arpa/inet.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
 #include <spdlog/fmt/ostr.h>
 #include <spdlog/spdlog.h>
 
-#include <caracal/lpm.hpp>
-#include <caracal/pretty.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <caracal/checked.hpp>
+#include <caracal/permutation.hpp>
 #include <caracal/probe.hpp>
 #include <caracal/prober.hpp>
 #include <caracal/prober_config.hpp>
-#include <caracal/rate_limiter.hpp>
-#include <caracal/sender.hpp>
-#include <caracal/sniffer.hpp>
-#include <caracal/statistics.hpp>
-#include <chrono>
-#include <iostream>
-#include <tuple>
+#include <caracal/prober_session.hpp>
+#include <caracal/reply_sink.hpp>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <streambuf>
+#include <system_error>
+#include <utility>
+#include <vector>
 
 namespace caracal::Prober {
 
-using std::chrono::microseconds;
-using std::chrono::milliseconds;
-
-ProbingStatistics probe(const Config& config, Iterator& it) {
-  spdlog::info(config);
+/// A stream buffer over a (socket) file descriptor, used by the daemon mode.
+/// The probes are read from the main thread while the replies are written
+/// from the sniffer thread: each direction must use its own instance.
+/// The buffer must be destroyed before the file descriptor is closed.
+class FdStreambuf : public std::streambuf {
+ public:
+  explicit FdStreambuf(int fd) : fd_{fd}, input_{}, output_{} {
+    setg(input_.data(), input_.data(), input_.data());
+    setp(output_.data(), output_.data() + output_.size());
+  }
 
-  LPM prefix_excl;
-  LPM prefix_incl;
+  ~FdStreambuf() override { sync(); }
 
-  if (config.prefix_excl_file) {
-    spdlog::info("Loading excluded prefixes...");
-    prefix_excl.insert_file(*config.prefix_excl_file);
+ protected:
+  int_type underflow() override {
+    ssize_t n;
+    do {
+      n = ::read(fd_, input_.data(), input_.size());
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) {
+      return traits_type::eof();
+    }
+    setg(input_.data(), input_.data(), input_.data() + n);
+    return traits_type::to_int_type(*gptr());
   }
 
-  if (config.prefix_incl_file) {
-    spdlog::info("Loading included prefixes...");
-    prefix_incl.insert_file(*config.prefix_incl_file);
+  int_type overflow(int_type c) override {
+    if (sync() != 0) {
+      return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+    return traits_type::not_eof(c);
   }
 
-  // Sniffer
-  Sniffer sniffer{config.interface, config.meta_round, config.caracal_id,
-                  config.integrity_check};
-  sniffer.start();
-
-  // Sender
-  Sender sender{config};
+  int sync() override {
+    auto data = pbase();
+    while (data < pptr()) {
+      // MSG_NOSIGNAL: do not raise SIGPIPE if the client went away.
+      const auto n = ::send(fd_, data, pptr() - data, MSG_NOSIGNAL);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        setp(output_.data(), output_.data() + output_.size());
+        return -1;
+      }
+      data += n;
+    }
+    setp(output_.data(), output_.data() + output_.size());
+    return 0;
+  }
 
-  // Rate limiter
-  RateLimiter rl{config.probing_rate, config.batch_size,
-                 config.rate_limiting_method};
+ private:
+  int fd_;
+  std::array<char, 65536> input_;
+  std::array<char, 65536> output_;
+};
 
-  // Statistics
-  Statistics::Prober stats;
-  auto log_stats = [&] {
-    spdlog::info(rl.statistics());
-    spdlog::info(stats);
-    spdlog::info(sniffer.statistics());
-    spdlog::info(sniffer.pcap_statistics());
+Iterator csv_iterator(std::istream& is, const bool stop_on_empty_line) {
+  return [&is, stop_on_empty_line, line = std::string{}](Probe& p) mutable {
+    bool valid = false;
+    // Iterate until we find the next valid probe, or we reach EOF.
+    while (!valid && std::getline(is, line)) {
+      if (stop_on_empty_line && line.empty()) {
+        break;
+      }
+      try {
+        p = Probe::from_csv(line);
+        valid = true;
+      } catch (const std::exception& e) {
+        spdlog::warn("line={} error={}", line, e.what());
+      }
+    }
+    return valid;
   };
+}
 
-  // Log statistics every 5 seconds
-  auto stop_stats_thread = false;
-  std::thread stats_thread{[&] {
-    milliseconds elapsed{0};
-    const milliseconds refresh{100};
-    const milliseconds interval{5000};
-    while (!stop_stats_thread) {
-      std::this_thread::sleep_for(refresh);
-      elapsed += refresh;
-      if (elapsed >= interval) {
-        log_stats();
-        elapsed = milliseconds{0};
+Iterator binary_iterator(std::istream& is,
+                         const std::optional<uint64_t> count) {
+  return [&is, remaining = count](Probe& p) mutable {
+    std::array<char, Probe::binary_size> buffer{};
+    while ((!remaining || *remaining > 0) &&
+           is.read(buffer.data(), buffer.size())) {
+      if (remaining) {
+        (*remaining)--;
+      }
+      try {
+        p = Probe::from_binary(reinterpret_cast<std::byte*>(buffer.data()));
+        return true;
+      } catch (const std::exception& e) {
+        spdlog::warn("error={}", e.what());
       }
     }
-  }};
-
-  // Loop
-  Probe p{};
-
-  while (it(p)) {
-    stats.read++;
+    return false;
+  };
+}
 
-    // TTL filter
-    if (config.filter_min_ttl && (p.ttl < *config.filter_min_ttl)) {
-      spdlog::trace("{} filter=ttl_too_low", p);
-      stats.filtered_lo_ttl++;
-      continue;
+Iterator random_iterator(std::vector<in6_addr> destinations,
+                         const uint8_t min_ttl, const uint8_t max_ttl,
+                         const Protocols::L4 protocol, const uint64_t key) {
+  if (destinations.empty() || min_ttl > max_ttl) {
+    throw std::invalid_argument("no destinations or invalid TTL range");
+  }
+  const uint64_t n_ttls = max_ttl - min_ttl + 1;
+  Permutation permutation{destinations.size() * n_ttls, key};
+  return [destinations = std::move(destinations), permutation, min_ttl,
+          n_ttls, protocol, i = uint64_t{0}](Probe& p) mutable {
+    if (i == permutation.size()) {
+      return false;
     }
-    if (config.filter_max_ttl && (p.ttl > *config.filter_max_ttl)) {
-      spdlog::trace("{} filter=ttl_too_high", p);
-      stats.filtered_hi_ttl++;
-      continue;
+    const auto j = permutation(i++);
+    p = Probe{};
+    p.dst_addr = destinations[j / n_ttls];
+    p.src_port = 24000;
+    p.dst_port = 33434;
+    p.ttl = static_cast<uint8_t>(min_ttl + j % n_ttls);
+    p.protocol = protocol;
+    if (protocol != Protocols::L4::UDP) {
+      p.protocol = IN6_IS_ADDR_V4MAPPED(&p.dst_addr) ? Protocols::L4::ICMP
+                                                      : Protocols::L4::ICMPv6;
     }
+    return true;
+  };
+}
 
-    // Prefix filter
-    // Do not send probes to excluded prefixes (deny list).
-    if (config.prefix_excl_file && prefix_excl.lookup(p.dst_addr)) {
-      spdlog::trace("{} filter=prefix_excluded", p);
-      stats.filtered_prefix_excl++;
-      continue;
-    }
-    // Do not send probes to *not* included prefixes.
-    // i.e. send probes only to included prefixes (allow list).
-    if (config.prefix_incl_file && !prefix_incl.lookup(p.dst_addr)) {
-      spdlog::trace("{} filter=prefix_not_included", p);
-      stats.filtered_prefix_not_incl++;
-      continue;
+Iterator sweep_iterator(const std::vector<std::string>& prefixes,
+                        const Protocols::L4 protocol, const uint64_t key) {
+  if (protocol == Protocols::L4::ICMPv6) {
+    throw std::invalid_argument("ping sweeps are IPv4 only");
+  }
+  // (first address, cumulative number of addresses) of each prefix.
+  std::vector<std::pair<uint32_t, uint64_t>> ranges;
+  uint64_t total = 0;
+  for (const auto& prefix : prefixes) {
+    const auto slash = prefix.find('/');
+    const auto length = slash == std::string::npos
+                            ? 32
+                            : Checked::stou8(prefix.substr(slash + 1));
+    in_addr addr{};
+    if (length > 32 ||
+        inet_pton(AF_INET, prefix.substr(0, slash).c_str(), &addr) != 1) {
+      throw std::invalid_argument("Invalid IPv4 prefix: " + prefix);
     }
+    const uint64_t count = uint64_t{1} << (32 - length);
+    const auto first =
+        static_cast<uint32_t>(ntohl(addr.s_addr) & ~(count - 1));
+    total += count;
+    ranges.emplace_back(first, total);
+  }
+  if (total == 0) {
+    throw std::invalid_argument("no prefixes");
+  }
 
-    for (uint64_t i = 0; i < config.n_packets; i++) {
-      spdlog::trace("{} id={} packet={}", p, p.checksum(config.caracal_id),
-                    i + 1);
-      try {
-        sender.send(p);
-        stats.sent++;
-      } catch (const std::runtime_error& e) {
-        spdlog::error("{} error={}", p, e.what());
-        stats.failed++;
-      }
-      // Wait if requested.
-      if (p.wait_us > 0) {
-        std::this_thread::sleep_for(microseconds{p.wait_us});
-      }
-      // Rate limit every `batch_size` packets sent.
-      if ((stats.sent + stats.failed) % config.batch_size == 0) {
-        rl.wait();
-      }
+  Permutation permutation{total, key};
+  return [ranges = std::move(ranges), permutation, protocol,
+          i = uint64_t{0}](Probe& p) mutable {
+    if (i == permutation.size()) {
+      return false;
     }
+    const auto j = permutation(i++);
+    const auto range = std::upper_bound(
+        ranges.begin(), ranges.end(), j,
+        [](uint64_t v, const auto& r) { return v < r.second; });
+    const uint64_t offset = range == ranges.begin() ? 0 : (range - 1)->second;
+    p = Probe{};
+    p.dst_addr.s6_addr32[2] = htonl(0x0000FFFF);
+    p.dst_addr.s6_addr32[3] =
+        htonl(static_cast<uint32_t>(range->first + (j - offset)));
+    p.src_port = 24000;
+    p.dst_port = 33434;
+    p.ttl = 255;
+    p.protocol = protocol;
+    return true;
+  };
+}
 
-    if (config.max_probes && (stats.sent >= *config.max_probes)) {
-      spdlog::trace("max_probes reached, exiting...");
-      break;
-    }
-  }
+ProbingStatistics probe(const Config& config, Iterator& it) {
+  Session session{config};
+  return session.run(it, config.meta_round);
+}
 
-  spdlog::info(
-      "Waiting {}s to allow the sniffer to get the last flying responses...",
-      config.sniffer_wait_time);
-  std::this_thread::sleep_for(std::chrono::seconds(config.sniffer_wait_time));
-  sniffer.stop();
+ProbingStatistics probe(const Config& config, std::istream& is) {
+  auto iterator = csv_iterator(is);
+  return probe(config, iterator);
+}
 
-  // Stop logger thread and print statistics one last time.
-  stop_stats_thread = true;
-  stats_thread.join();
-  log_stats();
+namespace {
 
-  return {stats, sniffer.statistics(), sniffer.pcap_statistics()};
+void set_timeout(const int fd, const int option,
+                 const std::chrono::milliseconds timeout) {
+  timeval tv{};
+  tv.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+  tv.tv_usec = static_cast<suseconds_t>((timeout.count() % 1000) * 1000);
+  if (setsockopt(fd, SOL_SOCKET, option, &tv, sizeof(tv)) < 0) {
+    throw std::system_error(errno, std::generic_category(), "setsockopt");
+  }
 }
 
-ProbingStatistics probe(const Config& config, std::istream& is) {
+}  // namespace
+
+void serve_connection(const int fd, const RoundRunner& run,
+                      const std::chrono::milliseconds timeout) {
+  // A client which stops sending or reading must not block the daemon (and
+  // the sniffer thread, which writes the replies): a read that times out
+  // ends the probes, and a write that times out drops the replies.
+  set_timeout(fd, SO_RCVTIMEO, timeout);
+  set_timeout(fd, SO_SNDTIMEO, timeout);
+
+  // Separate buffers for the probes (read from this thread) and the replies
+  // (written from the sniffer thread).
+  FdStreambuf input_buffer{fd};
+  FdStreambuf output_buffer{fd};
+  std::istream input{&input_buffer};
+  std::ostream output{&output_buffer};
+
+  // Header line: `<csv|binary> <round> [count]`.
   std::string line;
-  Iterator iterator = [&](Probe& p) {
-    bool valid = false;
-    // Iterate until we find the next valid probe, or we reach EOF.
-    while (!valid && std::getline(is, line)) {
-      try {
-        p = Probe::from_csv(line);
-        valid = true;
-      } catch (const std::exception& e) {
-        spdlog::warn("line={} error={}", line, e.what());
+  std::string format;
+  std::string round;
+  std::string count;
+  std::getline(input, line);
+  std::istringstream{line} >> format >> round >> count;
+  const auto valid_count =
+      count.empty() ||
+      (format == "binary" &&
+       count.find_first_not_of("0123456789") == std::string::npos);
+  if ((format != "csv" && format != "binary") || round.empty() ||
+      !valid_count) {
+    spdlog::warn("header={} error=invalid header", line);
+    output << "error: expected `<csv|binary> <round> [count]`\n";
+    output.flush();
+    return;
+  }
+
+  spdlog::info("round={} format={} count={}", round, format, count);
+  std::optional<uint64_t> limit;
+  if (!count.empty()) {
+    limit = std::stoull(count);
+  }
+  auto iterator = format == "csv" ? csv_iterator(input, true)
+                                  : binary_iterator(input, limit);
+  run(iterator, round, std::make_shared<CsvSink>(output));
+  output.flush();
+  if (!output) {
+    spdlog::warn("round={} error=replies dropped, the client is not reading",
+                 round);
+  }
+}
+
+void serve(const Config& config, const fs::path& socket_path) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (socket_path.string().size() >= sizeof(addr.sun_path)) {
+    throw std::invalid_argument(socket_path.string() + " is too long");
+  }
+  std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+  const int server = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (server < 0) {
+    throw std::system_error(errno, std::generic_category(), "socket");
+  }
+  // Remove a stale socket left by a previous instance.
+  fs::remove(socket_path);
+  if (bind(server, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+      listen(server, 16) < 0) {
+    const auto error = errno;
+    close(server);
+    throw std::system_error(error, std::generic_category(),
+                            "bind " + socket_path.string());
+  }
+
+  // The sniffer, the sender and the rate limiter are kept open for the
+  // lifetime of the daemon, only the replies output changes between rounds.
+  Session session{config, nullptr};
+
+  spdlog::info("Listening on {}...", socket_path.string());
+
+  while (true) {
+    const int client = accept(server, nullptr, nullptr);
+    if (client < 0) {
+      if (errno == EINTR) {
+        continue;
       }
+      const auto error = errno;
+      close(server);
+      throw std::system_error(error, std::generic_category(), "accept");
     }
-    return valid;
-  };
-  return probe(config, iterator);
+
+    // A failed round (e.g. a client that went away) must not stop the
+    // daemon.
+    try {
+      serve_connection(client, [&](Iterator& it, const std::string& round,
+                                   std::shared_ptr<ReplySink> sink) {
+        session.set_sink(std::move(sink));
+        try {
+          session.run(it, round);
+        } catch (...) {
+          session.set_sink(nullptr);
+          throw;
+        }
+        // Flush the sink and stop writing to the connection.
+        session.set_sink(nullptr);
+      });
+    } catch (const std::exception& e) {
+      spdlog::error("error={}", e.what());
+    }
+    close(client);
+  }
 }
 
 }  // namespace caracal::Prober
@@ -1,7 +1,9 @@
+#include <caracal/affinity.hpp>
 #include <caracal/prober_config.hpp>
 #include <filesystem>
 #include <optional>
 #include <random>
+#include <sstream>
 #include <string>
 
 using std::optional;
@@ -71,6 +73,29 @@ void Config::set_rate_limiting_method(const string& s) {
   }
 }
 
+void Config::set_output_format(const string& s) {
+  if (s == "csv" || s == "binary") {
+    output_format = s;
+  } else {
+    throw std::invalid_argument(s + " is not a valid output format");
+  }
+}
+
+void Config::set_output_shm(const string& name) {
+  if (name.empty() || name.front() != '/' ||
+      name.find('/', 1) != string::npos) {
+    throw std::invalid_argument(name + " is not a valid shared-memory name");
+  }
+  output_shm = name;
+}
+
+void Config::set_output_shm_capacity(const int capacity) {
+  if (capacity <= 0 || (capacity & (capacity - 1)) != 0) {
+    throw std::domain_error("output_shm_capacity must be a power of two");
+  }
+  output_shm_capacity = static_cast<uint64_t>(capacity);
+}
+
 void Config::set_ip_version(uint8_t version) {
   if (version != 4 && version != 6) {
       throw std::invalid_argument(std::to_string(version) + " should be either 4 or 6");
@@ -123,6 +148,116 @@ void Config::set_filter_max_ttl(const int ttl) {
 
 void Config::set_meta_round(const string& round) { meta_round = round; }
 
+void Config::set_drain_rtt_factor(const int factor) {
+  if (factor <= 0) {
+    throw std::domain_error("drain_rtt_factor must be > 0");
+  }
+  drain_rtt_factor = static_cast<uint64_t>(factor);
+}
+
+void Config::set_stop_set(const bool enabled) { stop_set = enabled; }
+
+void Config::set_prune_reached(const bool enabled) { prune_reached = enabled; }
+
+void Config::set_dedup_fp_rate(const double rate) {
+  if (rate <= 0 || rate >= 1) {
+    throw std::domain_error("dedup_fp_rate must be in ]0, 1[");
+  }
+  dedup_fp_rate = rate;
+}
+
+void Config::add_source(const string& spec) {
+  std::istringstream ss{spec};
+  Source source;
+  std::getline(ss, source.interface, ',');
+  if (source.interface.empty()) {
+    throw std::invalid_argument(spec + " is not a valid source");
+  }
+  string address;
+  while (std::getline(ss, address, ',')) {
+    if (address.find(':') != string::npos && !source.source_ipv6) {
+      source.source_ipv6 = Tins::IPv6Address(address);
+    } else if (address.find('.') != string::npos && !source.source_ipv4) {
+      source.source_ipv4 = Tins::IPv4Address(address);
+    } else {
+      throw std::invalid_argument(spec + " is not a valid source");
+    }
+  }
+  sources.push_back(source);
+}
+
+void Config::set_sender_cpus(const string& cpus) {
+  sender_cpus = Affinity::parse_cpu_list(cpus);
+}
+
+void Config::set_sniffer_cpus(const string& cpus) {
+  sniffer_cpus = Affinity::parse_cpu_list(cpus);
+}
+
+void Config::set_stats_cpus(const string& cpus) {
+  stats_cpus = Affinity::parse_cpu_list(cpus);
+}
+
+void Config::set_numa_local(const bool enabled) { numa_local = enabled; }
+
+void Config::set_realtime_priority(const int priority) {
+  if (priority < 1 || priority > 99) {
+    throw std::domain_error("realtime_priority must be between 1 and 99");
+  }
+  realtime_priority = priority;
+}
+
+void Config::set_busy_poll(const int usecs) {
+  if (usecs <= 0) {
+    throw std::domain_error("busy_poll must be > 0");
+  }
+  busy_poll = usecs;
+}
+
+void Config::set_qdisc_bypass(const bool enabled) { qdisc_bypass = enabled; }
+
+void Config::set_strict_filter(const bool enabled) { strict_filter = enabled; }
+
+void Config::set_tx_timestamps(const bool enabled) { tx_timestamps = enabled; }
+
+void Config::set_output_pcap(const fs::path& prefix) {
+  const auto parent = prefix.parent_path();
+  if (prefix.filename().empty() ||
+      (!parent.empty() && !fs::is_directory(parent))) {
+    throw std::invalid_argument(prefix.string() +
+                                " is not a valid capture file prefix");
+  }
+  output_pcap = prefix;
+}
+
+void Config::set_output_pcap_rotate_size(const int megabytes) {
+  if (megabytes <= 0) {
+    throw std::domain_error("output_pcap_rotate_size must be > 0");
+  }
+  output_pcap_rotate_size = static_cast<uint64_t>(megabytes);
+}
+
+void Config::set_output_pcap_rotate_interval(const int seconds) {
+  if (seconds <= 0) {
+    throw std::domain_error("output_pcap_rotate_interval must be > 0");
+  }
+  output_pcap_rotate_interval = static_cast<uint64_t>(seconds);
+}
+
+void Config::set_output_pcap_zstd(const bool enabled) {
+  output_pcap_zstd = enabled;
+}
+
+void Config::set_output_probes(const fs::path& path) {
+  const auto parent = path.parent_path();
+  if (path.filename().empty() ||
+      (!parent.empty() && !fs::is_directory(parent))) {
+    throw std::invalid_argument(path.string() +
+                                " is not a valid probe log file");
+  }
+  output_probes = path;
+}
+
 std::ostream& operator<<(std::ostream& os, Config const& v) {
   auto print_if_value = [&os](const string& name, const auto opt) {
     if (opt) {
@@ -137,12 +272,51 @@ std::ostream& operator<<(std::ostream& os, Config const& v) {
   os << " integrity_check=" << v.integrity_check;
   os << " interface=" << v.interface;
   os << " rate_limiting_method=" << v.rate_limiting_method;
+  os << " output_format=" << v.output_format;
   print_if_value("max_probes", v.max_probes);
   print_if_value("prefix_excl_file", v.prefix_excl_file);
   print_if_value("prefix_incl_file", v.prefix_incl_file);
   print_if_value("min_ttl", v.filter_min_ttl);
   print_if_value("max_ttl", v.filter_max_ttl);
+  print_if_value("output_shm", v.output_shm);
+  if (v.output_shm) {
+    os << " output_shm_capacity=" << v.output_shm_capacity;
+  }
   print_if_value("round", v.meta_round);
+  print_if_value("drain_rtt_factor", v.drain_rtt_factor);
+  os << " stop_set=" << v.stop_set;
+  os << " prune_reached=" << v.prune_reached;
+  print_if_value("dedup_fp_rate", v.dedup_fp_rate);
+  for (const auto& source : v.sources) {
+    os << " source=" << source.interface;
+    if (source.source_ipv4) {
+      os << "," << source.source_ipv4->to_string();
+    }
+    if (source.source_ipv6) {
+      os << "," << source.source_ipv6->to_string();
+    }
+  }
+  auto print_if_cpus = [&os](const string& name, const auto& cpus) {
+    if (!cpus.empty()) {
+      os << " " << name << "=" << Affinity::format_cpu_list(cpus);
+    }
+  };
+  print_if_cpus("sender_cpus", v.sender_cpus);
+  print_if_cpus("sniffer_cpus", v.sniffer_cpus);
+  print_if_cpus("stats_cpus", v.stats_cpus);
+  os << " numa_local=" << v.numa_local;
+  print_if_value("realtime_priority", v.realtime_priority);
+  print_if_value("busy_poll", v.busy_poll);
+  os << " qdisc_bypass=" << v.qdisc_bypass;
+  os << " strict_filter=" << v.strict_filter;
+  os << " tx_timestamps=" << v.tx_timestamps;
+  print_if_value("output_pcap", v.output_pcap);
+  if (v.output_pcap) {
+    os << " output_pcap_rotate_size=" << v.output_pcap_rotate_size;
+    os << " output_pcap_rotate_interval=" << v.output_pcap_rotate_interval;
+    os << " output_pcap_zstd=" << v.output_pcap_zstd;
+  }
+  print_if_value("output_probes", v.output_probes);
   return os;
 }
 
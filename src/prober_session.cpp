@@ -0,0 +1,614 @@
+#include <spdlog/fmt/ostr.h>
+#include <spdlog/spdlog.h>
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <caracal/affinity.hpp>
+#include <caracal/bloom_filter.hpp>
+#include <caracal/feedback.hpp>
+#include <caracal/lpm.hpp>
+#include <caracal/pcap_writer.hpp>
+#include <caracal/pretty.hpp>
+#include <caracal/probe.hpp>
+#include <caracal/probe_log.hpp>
+#include <caracal/prober.hpp>
+#include <caracal/prober_config.hpp>
+#include <caracal/prober_session.hpp>
+#include <caracal/rate_limiter.hpp>
+#include <caracal/reply_sink.hpp>
+#include <caracal/sender.hpp>
+#include <caracal/shm_ring.hpp>
+#include <caracal/sniffer.hpp>
+#include <caracal/statistics.hpp>
+#include <caracal/timestamp.hpp>
+#include <chrono>
+#include <deque>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace caracal::Prober {
+
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+using std::chrono::nanoseconds;
+using std::chrono::steady_clock;
+using std::chrono::system_clock;
+
+namespace {
+
+/// Hash of the fields compared by Probe::operator==.
+uint64_t probe_hash(const Probe& p) noexcept {
+  uint64_t words[2];
+  std::memcpy(words, &p.dst_addr, sizeof(words));
+  uint64_t hash = mix64(words[0]);
+  hash = mix64(hash ^ words[1]);
+  hash = mix64(hash ^ (uint64_t{p.src_port} << 48 |
+                       uint64_t{p.dst_port} << 32 | uint64_t{p.ttl} << 24 |
+                       static_cast<uint64_t>(p.protocol) << 20 |
+                       p.flow_label));
+  return hash;
+}
+
+/// Maximum number of probes waiting for their kernel timestamp, per sender.
+/// The error queue of the socket holds much less timestamps: the older
+/// probes will not get theirs.
+constexpr size_t max_pending_probes = 65536;
+
+/// Whether a probe parsed from a sent packet (see Parser::parse_probe) is
+/// `sent`. The destination port of the ICMP probes is not encoded in the
+/// packet, and neither is the flow label of the IPv4 probes.
+bool same_packet(const Probe& sent, const Probe& parsed) noexcept {
+  return IN6_ARE_ADDR_EQUAL(&sent.dst_addr, &parsed.dst_addr) &&
+         sent.src_port == parsed.src_port && sent.ttl == parsed.ttl &&
+         sent.protocol == parsed.protocol &&
+         (sent.protocol != Protocols::L4::UDP ||
+          sent.dst_port == parsed.dst_port);
+}
+
+/// Hash of the destination address, so that all the probes towards a
+/// destination are sent from the same source.
+uint64_t destination_hash(const Probe& p) noexcept {
+  uint64_t words[2];
+  std::memcpy(words, &p.dst_addr, sizeof(words));
+  return mix64(mix64(words[0]) ^ words[1]);
+}
+
+/// The configuration of the sender of each source.
+std::vector<Config> sender_configs(const Config& config) {
+  if (config.sources.empty()) {
+    return {config};
+  }
+  std::vector<Config> configs;
+  for (const auto& source : config.sources) {
+    auto sender_config = config;
+    sender_config.interface = source.interface;
+    sender_config.source_ipv4 = source.source_ipv4;
+    sender_config.source_ipv6 = source.source_ipv6;
+    configs.push_back(sender_config);
+  }
+  return configs;
+}
+
+std::shared_ptr<ReplySink> default_sink(const Config& config) {
+  if (config.output_shm) {
+    return std::make_shared<ShmRingSink>(*config.output_shm,
+                                         config.output_shm_capacity);
+  }
+  return make_sink(config.output_format, std::cout);
+}
+
+}  // namespace
+
+Session::Session(const Config& config)
+    : Session{config, default_sink(config)} {}
+
+Session::Session(const Config& config, std::shared_ptr<ReplySink> sink)
+    : config_{config},
+      prefix_excl_{},
+      prefix_incl_{},
+      sniffers_{},
+      senders_{},
+      numa_cpus_{},
+      rate_limiter_{config.probing_rate, config.batch_size,
+                    config.rate_limiting_method},
+      statistics_{},
+      sink_{},
+      feedback_{},
+      tx_timestamp_handler_{},
+      probe_log_{},
+      pending_probes_{},
+      dedup_{},
+      checked_drops_{},
+      running_{false},
+      stop_stats_thread_{false} {
+  spdlog::info(config_);
+
+  if (config_.prefix_excl_file) {
+    spdlog::info("Loading excluded prefixes...");
+    prefix_excl_.insert_file(*config_.prefix_excl_file);
+  }
+
+  if (config_.prefix_incl_file) {
+    spdlog::info("Loading included prefixes...");
+    prefix_incl_.insert_file(*config_.prefix_incl_file);
+  }
+
+  const auto configs = sender_configs(config_);
+
+  // The threads without a CPU list run on the NUMA node of the interface.
+  // The session is opened from this node so that the capture rings and the
+  // send buffers are allocated in its memory (first-touch policy), and the
+  // threads created here inherit its CPUs. The caller is moved back to its
+  // previous CPUs at the end of the constructor.
+  std::optional<Affinity::ScopedThreadPlacement> session_placement;
+  if (config_.numa_local) {
+    numa_cpus_ = Affinity::numa_node_cpus(configs.front().interface);
+    if (numa_cpus_.empty()) {
+      spdlog::warn("NUMA node of {} not found", configs.front().interface);
+    }
+    session_placement.emplace(pthread_self(), "session", numa_cpus_,
+                              std::nullopt);
+  }
+
+  // One sender per source, and one sniffer per interface.
+  std::vector<std::string> interfaces;
+  std::vector<SnifferFilter> filters;
+  for (const auto& sender_config : configs) {
+    const auto& interface = sender_config.interface;
+    senders_.push_back(std::make_unique<Sender>(sender_config));
+    auto it = std::find(interfaces.begin(), interfaces.end(), interface);
+    if (it == interfaces.end()) {
+      interfaces.push_back(interface);
+      filters.emplace_back();
+      it = std::prev(interfaces.end());
+    }
+    if (config_.strict_filter) {
+      auto& filter = filters[std::distance(interfaces.begin(), it)];
+      const auto addresses = senders_.back()->source_addresses();
+      filter.addresses.insert(filter.addresses.end(), addresses.begin(),
+                              addresses.end());
+      filter.quoted_protocols = true;
+      if (config_.integrity_check) {
+        filter.caracal_id = config_.caracal_id;
+      }
+    }
+  }
+  // At most one reply is expected per probe.
+  const auto settings = capture_settings(config_.probing_rate,
+                                         config_.busy_poll);
+  checked_drops_.resize(interfaces.size(), 0);
+  for (size_t i = 0; i < interfaces.size(); i++) {
+    sniffers_.push_back(std::make_unique<Sniffer>(
+        interfaces[i], config_.meta_round, config_.caracal_id,
+        config_.integrity_check, settings, filters[i]));
+    if (config_.output_pcap) {
+      PcapWriter::Options options;
+      options.rotate_size = config_.output_pcap_rotate_size * 1024 * 1024;
+      options.rotate_interval =
+          std::chrono::seconds{config_.output_pcap_rotate_interval};
+      options.zstd = config_.output_pcap_zstd;
+      sniffers_.back()->set_pcap_writer(std::make_shared<PcapWriter>(
+          config_.output_pcap->string() + "-" + interfaces[i],
+          sniffers_.back()->link_type(), options));
+    }
+  }
+
+  if (config_.output_probes) {
+    probe_log_ = std::make_unique<ProbeLog>(*config_.output_probes);
+    pending_probes_.resize(senders_.size());
+  }
+
+  // The feedback state is kept across rounds.
+  if (config_.stop_set || config_.prune_reached) {
+    feedback_ = std::make_shared<Feedback>();
+    for (auto& sniffer : sniffers_) {
+      sniffer->set_feedback(feedback_);
+    }
+  }
+
+  set_sink(std::move(sink));
+  for (auto& sniffer : sniffers_) {
+    sniffer->start();
+    place_sniffer(*sniffer);
+  }
+
+  // Log statistics every 5 seconds, and grow the capture buffers which
+  // dropped packets every second, while a round is running.
+  stats_thread_ = std::thread{[this] {
+    milliseconds elapsed{0};
+    const milliseconds refresh{100};
+    const milliseconds drops_interval{1000};
+    const milliseconds interval{5000};
+    while (!stop_stats_thread_) {
+      std::this_thread::sleep_for(refresh);
+      elapsed += refresh;
+      if (running_ && elapsed % drops_interval == milliseconds{0}) {
+        grow_capture_buffers();
+      }
+      if (elapsed >= interval) {
+        if (running_) {
+          log_statistics();
+        }
+        elapsed = milliseconds{0};
+      }
+    }
+  }};
+  Affinity::set_thread_placement(stats_thread_.native_handle(), "stats",
+                                 cpus_for(config_.stats_cpus), std::nullopt);
+}
+
+Session::~Session() {
+  stop_stats_thread_ = true;
+  if (stats_thread_.joinable()) {
+    stats_thread_.join();
+  }
+  for (auto& sniffer : sniffers_) {
+    sniffer->stop();
+  }
+}
+
+ProbingStatistics Session::run(Iterator& it,
+                               const std::optional<std::string>& round_id) {
+  for (auto& sniffer : sniffers_) {
+    sniffer->set_meta_round(round_id);
+  }
+  reset_sniffer_statistics();
+  std::vector<pcap_stat> pcap_before;
+  for (auto& sniffer : sniffers_) {
+    pcap_before.push_back(sniffer->pcap_statistics());
+  }
+  statistics_ = Statistics::Prober{};
+
+  // The send loop runs on the thread calling `run`, which is placed for the
+  // duration of the round only (e.g. the daemon accepts the connections from
+  // the same thread).
+  const Affinity::ScopedThreadPlacement sender_placement{
+      pthread_self(), "sender", cpus_for(config_.sender_cpus),
+      config_.realtime_priority};
+
+  if (config_.dedup_fp_rate) {
+    dedup_.emplace(*config_.dedup_fp_rate);
+  }
+  running_ = true;
+
+  send_probes(it);
+  drain();
+  // The timestamps of the last probes may arrive during the drain.
+  read_tx_timestamps();
+  flush_pending_probes();
+
+  // Print statistics one last time.
+  running_ = false;
+  log_statistics();
+
+  pcap_stat pcap_stats{};
+  for (size_t i = 0; i < sniffers_.size(); i++) {
+    const auto ps = sniffers_[i]->pcap_statistics();
+    pcap_stats.ps_recv += ps.ps_recv - pcap_before[i].ps_recv;
+    pcap_stats.ps_drop += ps.ps_drop - pcap_before[i].ps_drop;
+    pcap_stats.ps_ifdrop += ps.ps_ifdrop - pcap_before[i].ps_ifdrop;
+  }
+  auto sniffer_stats = reset_sniffer_statistics();
+
+  return {statistics_, sniffer_stats, pcap_stats};
+}
+
+ProbingStatistics Session::run(std::istream& is,
+                               const std::optional<std::string>& round_id) {
+  auto iterator = csv_iterator(is);
+  return run(iterator, round_id);
+}
+
+void Session::set_tx_timestamp_handler(Sender::TxTimestampCallback handler) {
+  tx_timestamp_handler_ = std::move(handler);
+}
+
+void Session::set_sink(std::shared_ptr<ReplySink> sink) {
+  sink_ = sink;
+  // The sniffers run on different threads.
+  if (sink && sniffers_.size() > 1) {
+    sink = std::make_shared<SynchronizedSink>(std::move(sink));
+  }
+  for (auto& sniffer : sniffers_) {
+    sniffer->set_sink(sink);
+  }
+}
+
+const std::shared_ptr<ReplySink>& Session::sink() const noexcept {
+  return sink_;
+}
+
+const Config& Session::config() const noexcept { return config_; }
+
+void Session::send_probes(Iterator& it) {
+  Probe p{};
+
+  while (it(p)) {
+    statistics_.read++;
+
+    // Duplicate filter
+    if (dedup_ && !dedup_->insert(probe_hash(p))) {
+      spdlog::trace("{} filter=duplicate", p);
+      statistics_.filtered_duplicate++;
+      continue;
+    }
+
+    // TTL filter
+    if (config_.filter_min_ttl && (p.ttl < *config_.filter_min_ttl)) {
+      spdlog::trace("{} filter=ttl_too_low", p);
+      statistics_.filtered_lo_ttl++;
+      continue;
+    }
+    if (config_.filter_max_ttl && (p.ttl > *config_.filter_max_ttl)) {
+      spdlog::trace("{} filter=ttl_too_high", p);
+      statistics_.filtered_hi_ttl++;
+      continue;
+    }
+
+    // Prefix filter
+    // Do not send probes to excluded prefixes (deny list).
+    if (config_.prefix_excl_file && prefix_excl_.lookup(p.dst_addr)) {
+      spdlog::trace("{} filter=prefix_excluded", p);
+      statistics_.filtered_prefix_excl++;
+      continue;
+    }
+    // Do not send probes to *not* included prefixes.
+    // i.e. send probes only to included prefixes (allow list).
+    if (config_.prefix_incl_file && !prefix_incl_.lookup(p.dst_addr)) {
+      spdlog::trace("{} filter=prefix_not_included", p);
+      statistics_.filtered_prefix_not_incl++;
+      continue;
+    }
+
+    // Stop set filter
+    if (config_.stop_set && feedback_->stopped(p)) {
+      spdlog::trace("{} filter=stop_set", p);
+      statistics_.filtered_stop_set++;
+      continue;
+    }
+
+    // Destination reached filter
+    if (config_.prune_reached && feedback_->reached(p)) {
+      spdlog::trace("{} filter=destination_reached", p);
+      statistics_.filtered_reached++;
+      continue;
+    }
+
+    for (uint64_t i = 0; i < config_.n_packets; i++) {
+      spdlog::trace("{} id={} packet={}", p, p.checksum(config_.caracal_id),
+                    i + 1);
+      try {
+        const auto index = sender_index(p);
+        auto& sender = *senders_[index];
+        sender.send(p);
+        statistics_.sent++;
+        if (probe_log_) {
+          const auto now = std::chrono::duration_cast<nanoseconds>(
+              system_clock::now().time_since_epoch());
+          if (!sender.tx_timestamps()) {
+            probe_log_->write(p, now);
+          } else {
+            // Logged once its kernel timestamp is reported.
+            auto& pending = pending_probes_[index];
+            if (pending.size() == max_pending_probes) {
+              probe_log_->write(pending.front().first,
+                                pending.front().second);
+              statistics_.tx_timestamps_missing++;
+              pending.pop_front();
+            }
+            pending.emplace_back(p, now);
+          }
+        }
+      } catch (const std::runtime_error& e) {
+        spdlog::error("{} error={}", p, e.what());
+        statistics_.failed++;
+      }
+      // Wait if requested.
+      if (p.wait_us > 0) {
+        std::this_thread::sleep_for(microseconds{p.wait_us});
+      }
+      // Rate limit every `batch_size` packets sent.
+      if ((statistics_.sent + statistics_.failed) % config_.batch_size == 0) {
+        read_tx_timestamps();
+        rate_limiter_.wait();
+      }
+    }
+
+    if (config_.max_probes && (statistics_.sent >= *config_.max_probes)) {
+      spdlog::trace("max_probes reached, exiting...");
+      break;
+    }
+  }
+  read_tx_timestamps();
+}
+
+void Session::read_tx_timestamps() {
+  for (size_t i = 0; i < senders_.size(); i++) {
+    statistics_.tx_timestamps += senders_[i]->read_tx_timestamps(
+        [this, i](const Probe& probe, nanoseconds timestamp) {
+          if (probe_log_) {
+            log_tx_timestamp(i, probe, timestamp);
+          }
+          if (tx_timestamp_handler_) {
+            tx_timestamp_handler_(probe, timestamp);
+          }
+        });
+  }
+}
+
+void Session::drain() {
+  const auto wait_time = std::chrono::seconds(config_.sniffer_wait_time);
+
+  if (!config_.drain_rtt_factor) {
+    spdlog::info(
+        "Waiting {}s to allow the sniffer to get the last flying responses...",
+        config_.sniffer_wait_time);
+    std::this_thread::sleep_for(wait_time);
+    return;
+  }
+
+  spdlog::info(
+      "Waiting up to {}s to allow the sniffer to get the last flying "
+      "responses...",
+      config_.sniffer_wait_time);
+  const auto start = steady_clock::now();
+  const auto deadline = start + wait_time;
+  const milliseconds refresh{10};
+  auto now = start;
+
+  while (now < deadline) {
+    // No reply since `drain_rtt_factor` × p99 RTT.
+    // We cannot estimate the RTT before receiving the first reply.
+    if (rtt_p99() > 0) {
+      const auto quiet_time = std::chrono::duration_cast<nanoseconds>(
+          Timestamp::tenth_ms{rtt_p99()} * *config_.drain_rtt_factor);
+      auto last_activity = start;
+      for (const auto& sniffer : sniffers_) {
+        last_activity = std::max(last_activity, sniffer->last_reply_time());
+      }
+      if (now - last_activity >= quiet_time) {
+        break;
+      }
+    }
+    std::this_thread::sleep_for(
+        std::min<steady_clock::duration>(refresh, deadline - now));
+    now = steady_clock::now();
+  }
+
+  spdlog::info("drain_time={}ms replies={} rtt_p99={}ms",
+               std::chrono::duration_cast<milliseconds>(now - start).count(),
+               replies_count(), rtt_p99() / 10.0);
+}
+
+void Session::log_statistics() {
+  spdlog::info(rate_limiter_.statistics());
+  spdlog::info(statistics_);
+  for (auto& sniffer : sniffers_) {
+    spdlog::info(sniffer->statistics());
+    spdlog::info("{} {}", sniffer->pcap_statistics(),
+                 sniffer->capture_settings());
+    if (const auto& writer = sniffer->pcap_writer()) {
+      spdlog::info("pcap_file_written={} pcap_file_dropped={}",
+                   writer->written(), writer->dropped());
+    }
+  }
+  if (probe_log_) {
+    spdlog::info("probe_log_written={} probe_log_dropped={}",
+                 probe_log_->written(), probe_log_->dropped());
+  }
+}
+
+std::vector<int> Session::cpus_for(const std::vector<int>& cpus) const {
+  return cpus.empty() ? numa_cpus_ : cpus;
+}
+
+void Session::place_sniffer(Sniffer& sniffer) {
+  Affinity::set_thread_placement(sniffer.native_handle(), "sniffer",
+                                 cpus_for(config_.sniffer_cpus),
+                                 config_.realtime_priority);
+}
+
+void Session::grow_capture_buffers() {
+  for (size_t i = 0; i < sniffers_.size(); i++) {
+    if (sniffers_[i]->pcap_statistics().ps_drop > checked_drops_[i]) {
+      grow_capture_buffer(*sniffers_[i]);
+    }
+    // Including the packets dropped during the reopening.
+    checked_drops_[i] = sniffers_[i]->pcap_statistics().ps_drop;
+  }
+}
+
+void Session::grow_capture_buffer(Sniffer& sniffer) {
+  auto settings = sniffer.capture_settings();
+  if (settings.buffer_size >= CaptureSettings::max_buffer_size) {
+    spdlog::warn("Packets were dropped with the largest capture buffer");
+    return;
+  }
+  settings.buffer_size =
+      std::min(settings.buffer_size * 2, CaptureSettings::max_buffer_size);
+  // Batch the deliveries to reduce the per-packet overhead.
+  if (settings.immediate_mode) {
+    settings.immediate_mode = false;
+    settings.timeout = 10;
+  }
+  spdlog::info("Packets were dropped, reopening the sniffer...");
+  try {
+    sniffer.reopen(settings);
+  } catch (const std::exception& e) {
+    spdlog::warn("sniffer_buffer_size={} error={}", settings.buffer_size,
+                 e.what());
+    // The thread was restarted with the previous settings.
+  }
+  place_sniffer(sniffer);
+}
+
+size_t Session::sender_index(const Probe& p) const noexcept {
+  if (senders_.size() == 1) {
+    return 0;
+  }
+  return destination_hash(p) % senders_.size();
+}
+
+void Session::log_tx_timestamp(const size_t index, const Probe& probe,
+                               const nanoseconds timestamp) {
+  // The timestamps are reported in the order in which the probes were sent.
+  auto& pending = pending_probes_[index];
+  const auto it =
+      std::find_if(pending.begin(), pending.end(), [&](const auto& entry) {
+        return same_packet(entry.first, probe);
+      });
+  if (it == pending.end()) {
+    // Already logged without its timestamp (see max_pending_probes).
+    return;
+  }
+  // The earlier probes will not get their timestamp, they are logged with the
+  // time of the send call so that the log holds every probe sent.
+  for (auto jt = pending.begin(); jt != it; ++jt) {
+    probe_log_->write(jt->first, jt->second);
+    statistics_.tx_timestamps_missing++;
+  }
+  probe_log_->write(it->first, timestamp);
+  pending.erase(pending.begin(), std::next(it));
+}
+
+void Session::flush_pending_probes() {
+  for (auto& pending : pending_probes_) {
+    for (const auto& [probe, timestamp] : pending) {
+      probe_log_->write(probe, timestamp);
+      statistics_.tx_timestamps_missing++;
+    }
+    pending.clear();
+  }
+}
+
+uint64_t Session::replies_count() const noexcept {
+  uint64_t count = 0;
+  for (const auto& sniffer : sniffers_) {
+    count += sniffer->replies_count();
+  }
+  return count;
+}
+
+uint32_t Session::rtt_p99() const noexcept {
+  uint32_t rtt = 0;
+  for (const auto& sniffer : sniffers_) {
+    rtt = std::max(rtt, sniffer->rtt_histogram().percentile(0.99));
+  }
+  return rtt;
+}
+
+Statistics::Sniffer Session::reset_sniffer_statistics() {
+  Statistics::Sniffer total{};
+  for (auto& sniffer : sniffers_) {
+    total += sniffer->reset_statistics();
+  }
+  return total;
+}
+
+}  // namespace caracal::Prober
@@ -24,6 +24,19 @@ uint8_t posix_value(L4 const &v) {
   }
 }
 
+L4 l4_from_posix(const uint8_t v) {
+  switch (v) {
+    case IPPROTO_ICMP:
+      return L4::ICMP;
+    case IPPROTO_ICMPV6:
+      return L4::ICMPv6;
+    case IPPROTO_UDP:
+      return L4::UDP;
+    default:
+      throw std::runtime_error("Invalid protocol: " + std::to_string(v));
+  }
+}
+
 L4 l4_from_string(std::string const &s) {
   if (s == "icmp") {
     return L4::ICMP;
@@ -0,0 +1,447 @@
+#include <fcntl.h>
+#include <spdlog/spdlog.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <tins/tins.h>
+#include <unistd.h>
+
+#include <caracal/parser.hpp>
+#include <caracal/reparse.hpp>
+#include <caracal/reply.hpp>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace caracal::Reparse {
+
+namespace {
+
+constexpr uint32_t pcap_magic_us = 0xa1b2c3d4;
+constexpr uint32_t pcap_magic_ns = 0xa1b23c4d;
+constexpr uint32_t pcapng_section_header = 0x0a0d0d0a;
+/// Magic number of a zstd frame (e.g. --output-pcap-zstd), little-endian.
+constexpr uint32_t zstd_frame = 0xfd2fb528;
+constexpr uint32_t pcapng_byte_order = 0x1a2b3c4d;
+constexpr uint32_t pcapng_interface_description = 1;
+constexpr uint32_t pcapng_simple_packet = 3;
+constexpr uint32_t pcapng_enhanced_packet = 6;
+constexpr uint16_t pcapng_if_tsresol = 9;
+
+uint16_t swap16(const uint16_t v) {
+  return static_cast<uint16_t>((v >> 8) | (v << 8));
+}
+
+uint32_t swap32(const uint32_t v) {
+  return (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24);
+}
+
+/// Read the integers of a file written with the byte order of another host.
+class Reader {
+ public:
+  Reader(const std::byte *data, const size_t size)
+      : data_{data}, size_{size}, swap_{false} {}
+
+  void set_swap(const bool swap) noexcept { swap_ = swap; }
+
+  [[nodiscard]] uint16_t u16(const size_t offset) const noexcept {
+    uint16_t v = 0;
+    std::memcpy(&v, data_ + offset, sizeof(v));
+    return swap_ ? swap16(v) : v;
+  }
+
+  [[nodiscard]] uint32_t u32(const size_t offset) const noexcept {
+    uint32_t v = 0;
+    std::memcpy(&v, data_ + offset, sizeof(v));
+    return swap_ ? swap32(v) : v;
+  }
+
+  /// Whether [offset, offset + n) is in the file.
+  [[nodiscard]] bool contains(const size_t offset,
+                              const size_t n) const noexcept {
+    return offset <= size_ && n <= size_ - offset;
+  }
+
+ private:
+  const std::byte *data_;
+  size_t size_;
+  bool swap_;
+};
+
+/// Convert a timestamp in units of 1/`units_per_second` seconds.
+timeval make_timeval(const uint64_t ts, const uint64_t units_per_second) {
+  timeval tv{};
+  tv.tv_sec = static_cast<time_t>(ts / units_per_second);
+  tv.tv_usec = static_cast<suseconds_t>((ts % units_per_second) * 1'000'000 /
+                                        units_per_second);
+  return tv;
+}
+
+/// The result of a range of frames: the replies, or their serialization if
+/// an output format is given.
+struct Range {
+  std::vector<Reply> replies;
+  std::string output;
+  Statistics::Sniffer statistics;
+};
+
+Range parse_range(const std::vector<CaptureFile::Frame> &frames,
+                  const size_t begin, const size_t end,
+                  const Options &options,
+                  const std::optional<std::string> &format,
+                  const std::string &round) {
+  Range range{};
+  std::array<std::byte, Reply::binary_size> buffer{};
+  for (size_t i = begin; i < end; i++) {
+    const auto &frame = frames[i];
+    // Same as Sniffer::handle.
+    auto reply = Parser::parse(frame.link_type, frame.header, frame.data);
+    if (reply &&
+        (!options.integrity_check || reply->is_valid(options.caracal_id))) {
+      range.statistics.observe(reply.value());
+      if (!format) {
+        range.replies.push_back(std::move(reply.value()));
+      } else if (*format == "csv") {
+        range.output += reply->to_csv(round) + "\n";
+      } else {
+        reply->to_binary(buffer.data());
+        range.output.append(reinterpret_cast<const char *>(buffer.data()),
+                            buffer.size());
+      }
+    } else {
+      range.statistics.received_invalid_count++;
+    }
+    range.statistics.received_count++;
+  }
+  return range;
+}
+
+}  // namespace
+
+CaptureFile::CaptureFile(const fs::path &path)
+    : path_{path}, data_{nullptr}, size_{0}, frames_{} {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(), path.string());
+  }
+  struct stat st {};
+  if (fstat(fd, &st) < 0) {
+    const auto error = errno;
+    close(fd);
+    throw std::system_error(error, std::generic_category(), "fstat");
+  }
+  size_ = static_cast<size_t>(st.st_size);
+  if (size_ < sizeof(uint32_t)) {
+    close(fd);
+    throw std::invalid_argument(path.string() + " is not a pcap file");
+  }
+  auto ptr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping remains valid after the file descriptor is closed.
+  close(fd);
+  if (ptr == MAP_FAILED) {
+    throw std::system_error(errno, std::generic_category(), "mmap");
+  }
+  data_ = static_cast<const std::byte *>(ptr);
+  // The file is read once, from the beginning to the end. madvise takes a
+  // single advice at a time.
+  madvise(ptr, size_, MADV_SEQUENTIAL);
+  madvise(ptr, size_, MADV_WILLNEED);
+
+  try {
+    uint32_t magic = 0;
+    std::memcpy(&magic, data_, sizeof(magic));
+    if (magic == pcapng_section_header) {
+      index_pcapng();
+    } else if (magic == zstd_frame || swap32(magic) == zstd_frame) {
+      throw std::invalid_argument(
+          path_.string() +
+          " is compressed with zstd, decompress it first (zstd -d)");
+    } else {
+      index_pcap();
+    }
+  } catch (...) {
+    munmap(const_cast<std::byte *>(data_), size_);
+    throw;
+  }
+  spdlog::info("file={} frames={}", path_.string(), frames_.size());
+}
+
+CaptureFile::~CaptureFile() {
+  munmap(const_cast<std::byte *>(data_), size_);
+}
+
+const std::vector<CaptureFile::Frame> &CaptureFile::frames() const noexcept {
+  return frames_;
+}
+
+void CaptureFile::index_pcap() {
+  Reader reader{data_, size_};
+  if (!reader.contains(0, 24)) {
+    throw std::invalid_argument(path_.string() + " is not a pcap file");
+  }
+  auto magic = reader.u32(0);
+  if (swap32(magic) == pcap_magic_us || swap32(magic) == pcap_magic_ns) {
+    reader.set_swap(true);
+    magic = swap32(magic);
+  }
+  if (magic != pcap_magic_us && magic != pcap_magic_ns) {
+    throw std::invalid_argument(path_.string() + " is not a pcap file");
+  }
+  const uint64_t units_per_second =
+      magic == pcap_magic_ns ? 1'000'000'000 : 1'000'000;
+  // The upper bits of the link type hold the FCS length, if any.
+  const int link_type = static_cast<int>(reader.u32(20) & 0xffff);
+
+  size_t offset = 24;
+  while (reader.contains(offset, 16)) {
+    Frame frame{};
+    frame.header.caplen = reader.u32(offset + 8);
+    frame.header.len = reader.u32(offset + 12);
+    if (!reader.contains(offset + 16, frame.header.caplen)) {
+      break;
+    }
+    const auto seconds = uint64_t{reader.u32(offset)};
+    const auto fraction = uint64_t{reader.u32(offset + 4)};
+    frame.header.ts =
+        make_timeval(seconds * units_per_second + fraction, units_per_second);
+    frame.link_type = link_type;
+    frame.data = reinterpret_cast<const u_char *>(data_ + offset + 16);
+    frames_.push_back(frame);
+    offset += 16 + frame.header.caplen;
+  }
+  if (offset != size_) {
+    spdlog::warn("file={} error=truncated offset={}", path_.string(), offset);
+  }
+}
+
+void CaptureFile::index_pcapng() {
+  struct Interface {
+    int link_type;
+    uint32_t snaplen;
+    uint64_t units_per_second;
+  };
+  std::vector<Interface> interfaces;
+  Reader reader{data_, size_};
+
+  size_t offset = 0;
+  while (reader.contains(offset, 12)) {
+    const auto type = reader.u32(offset);
+    if (type == pcapng_section_header) {
+      // A new section, possibly with another byte order.
+      const auto byte_order = reader.u32(offset + 8);
+      if (byte_order != pcapng_byte_order) {
+        if (swap32(byte_order) != pcapng_byte_order) {
+          throw std::invalid_argument(path_.string() +
+                                      " is not a pcapng file");
+        }
+        reader.set_swap(true);
+      } else {
+        reader.set_swap(false);
+      }
+      interfaces.clear();
+    }
+    const auto length = reader.u32(offset + 4);
+    if (length < 12 || length % 4 != 0 || !reader.contains(offset, length)) {
+      break;
+    }
+    const auto body = offset + 8;
+    const auto body_length = length - 12;
+
+    if (type == pcapng_interface_description && body_length >= 8) {
+      Interface interface{reader.u16(body), reader.u32(body + 4), 1'000'000};
+      // Options: code, length, value padded to 32 bits.
+      size_t option = body + 8;
+      while (option + 4 <= body + body_length) {
+        const auto code = reader.u16(option);
+        const auto option_length = reader.u16(option + 2);
+        if (code == 0 || option + 4 + option_length > body + body_length) {
+          break;
+        }
+        if (code == pcapng_if_tsresol && option_length >= 1) {
+          const auto resolution = static_cast<uint8_t>(data_[option + 4]);
+          const auto exponent = resolution & 0x7f;
+          // The units are 2^-exponent or 10^-exponent seconds.
+          uint64_t units = 1;
+          for (int i = 0; i < exponent && units < 1'000'000'000'000; i++) {
+            units *= (resolution & 0x80) ? 2 : 10;
+          }
+          interface.units_per_second = units;
+        }
+        option += 4 + (option_length + 3) / 4 * 4;
+      }
+      interfaces.push_back(interface);
+    } else if (type == pcapng_enhanced_packet && body_length >= 20) {
+      const auto id = reader.u32(body);
+      if (id < interfaces.size()) {
+        const auto &interface = interfaces[id];
+        Frame frame{};
+        frame.header.caplen =
+            std::min<uint32_t>(reader.u32(body + 12), body_length - 20);
+        frame.header.len = reader.u32(body + 16);
+        frame.header.ts = make_timeval(
+            (uint64_t{reader.u32(body + 4)} << 32) | reader.u32(body + 8),
+            interface.units_per_second);
+        frame.link_type = interface.link_type;
+        frame.data = reinterpret_cast<const u_char *>(data_ + body + 20);
+        frames_.push_back(frame);
+      }
+    } else if (type == pcapng_simple_packet && body_length >= 4 &&
+               !interfaces.empty()) {
+      // No timestamp, and the frame is truncated to the snaplen of the
+      // first interface.
+      const auto &interface = interfaces.front();
+      Frame frame{};
+      frame.header.len = reader.u32(body);
+      frame.header.caplen = std::min<uint32_t>(
+          {frame.header.len, body_length - 4,
+           interface.snaplen ? interface.snaplen : UINT32_MAX});
+      frame.link_type = interface.link_type;
+      frame.data = reinterpret_cast<const u_char *>(data_ + body + 4);
+      frames_.push_back(frame);
+    }
+    offset += length;
+  }
+  if (offset != size_) {
+    spdlog::warn("file={} error=truncated offset={}", path_.string(), offset);
+  }
+}
+
+namespace {
+
+/// Parse the ranges of frames on `options.threads` threads, and call
+/// `consume` on each range, in order, from the calling thread.
+Statistics::Sniffer parse_files(const std::vector<fs::path> &files,
+                                const Options &options,
+                                const std::optional<std::string> &format,
+                                const std::function<void(Range &)> &consume) {
+  const auto round = options.meta_round.value_or("1");
+  const auto range_size = std::max<size_t>(options.range_size, 1);
+  const auto threads = std::max(options.threads, 1U);
+  // Number of ranges parsed ahead of the output, to bound the memory usage.
+  const size_t window = threads * 4;
+  Statistics::Sniffer statistics{};
+
+  for (const auto &file : files) {
+    const CaptureFile capture{file};
+    const auto &frames = capture.frames();
+    const auto ranges = (frames.size() + range_size - 1) / range_size;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<std::optional<Range>> slots(window);
+    size_t next = 0;
+    size_t emitted = 0;
+
+    auto worker = [&]() {
+      while (true) {
+        size_t n = 0;
+        {
+          std::unique_lock lock{mutex};
+          cv.wait(lock,
+                  [&] { return next >= ranges || next < emitted + window; });
+          if (next >= ranges) {
+            return;
+          }
+          n = next++;
+        }
+        auto range = parse_range(frames, n * range_size,
+                                 std::min((n + 1) * range_size, frames.size()),
+                                 options, format, round);
+        {
+          std::scoped_lock lock{mutex};
+          slots[n % window] = std::move(range);
+        }
+        cv.notify_all();
+      }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < std::min<size_t>(threads, ranges); i++) {
+      workers.emplace_back(worker);
+    }
+
+    // Consume the ranges in order, as they complete.
+    std::exception_ptr error;
+    try {
+      while (emitted < ranges) {
+        Range range{};
+        {
+          std::unique_lock lock{mutex};
+          auto &slot = slots[emitted % window];
+          cv.wait(lock, [&] { return slot.has_value(); });
+          range = std::move(slot.value());
+          slot.reset();
+        }
+        consume(range);
+        statistics += range.statistics;
+        {
+          std::scoped_lock lock{mutex};
+          emitted++;
+        }
+        cv.notify_all();
+      }
+    } catch (...) {
+      error = std::current_exception();
+      {
+        std::scoped_lock lock{mutex};
+        next = ranges;
+      }
+      cv.notify_all();
+    }
+    for (auto &thread : workers) {
+      thread.join();
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  return statistics;
+}
+
+}  // namespace
+
+Statistics::Sniffer reparse(const std::vector<fs::path> &files,
+                            ReplySink &sink, const Options &options) {
+  const auto round = options.meta_round.value_or("1");
+  const auto statistics =
+      parse_files(files, options, std::nullopt, [&](Range &range) {
+        for (const auto &reply : range.replies) {
+          sink.write(reply, round);
+        }
+      });
+  sink.flush();
+  return statistics;
+}
+
+Statistics::Sniffer reparse(const std::vector<fs::path> &files,
+                            std::ostream &os, const std::string &format,
+                            const Options &options) {
+  if (format == "csv") {
+    os << (Reply::csv_header() + "\n");
+  } else if (format != "binary") {
+    throw std::invalid_argument(format + " is not a valid output format");
+  }
+  const auto statistics =
+      parse_files(files, options, format, [&](Range &range) {
+        os.write(range.output.data(),
+                 static_cast<std::streamsize>(range.output.size()));
+      });
+  os.flush();
+  return statistics;
+}
+
+}  // namespace caracal::Reparse
@@ -1,11 +1,14 @@
 #include <spdlog/fmt/fmt.h>
 #include <spdlog/fmt/ostr.h>
 
+#include <algorithm>
 #include <caracal/checksum.hpp>
 #include <caracal/constants.hpp>
 #include <caracal/pretty.hpp>
 #include <caracal/reply.hpp>
+#include <cstring>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 
 namespace caracal {
@@ -49,6 +52,108 @@ std::string Reply::csv_header() {
   return fmt::format("{}", fmt::join(columns, ","));
 }
 
+namespace {
+
+// Helpers for the binary format, in network order.
+template <typename T>
+void put_binary(std::byte*& data, const T value) noexcept {
+  const auto v = static_cast<uint64_t>(value);
+  for (size_t i = 0; i < sizeof(T); i++) {
+    data[i] = static_cast<std::byte>(v >> (8 * (sizeof(T) - 1 - i)));
+  }
+  data += sizeof(T);
+}
+
+void put_binary(std::byte*& data, const in6_addr& value) noexcept {
+  std::memcpy(data, &value, sizeof(in6_addr));
+  data += sizeof(in6_addr);
+}
+
+template <typename T>
+T get_binary(const std::byte*& data) noexcept {
+  uint64_t v = 0;
+  for (size_t i = 0; i < sizeof(T); i++) {
+    v = (v << 8) | std::to_integer<uint64_t>(data[i]);
+  }
+  data += sizeof(T);
+  return static_cast<T>(v);
+}
+
+void get_binary(const std::byte*& data, in6_addr& value) noexcept {
+  std::memcpy(&value, data, sizeof(in6_addr));
+  data += sizeof(in6_addr);
+}
+
+}  // namespace
+
+void Reply::to_binary(std::byte* data) const noexcept {
+  put_binary(data, capture_timestamp);
+  put_binary(data, reply_src_addr);
+  put_binary(data, reply_dst_addr);
+  put_binary(data, reply_id);
+  put_binary(data, reply_size);
+  put_binary(data, reply_ttl);
+  put_binary(data, reply_protocol);
+  put_binary(data, reply_icmp_type);
+  put_binary(data, reply_icmp_code);
+  put_binary(data, probe_dst_addr);
+  put_binary(data, probe_id);
+  put_binary(data, probe_flow_label);
+  put_binary(data, probe_size);
+  put_binary(data, probe_protocol);
+  put_binary(data, quoted_ttl);
+  put_binary(data, probe_src_port);
+  put_binary(data, probe_dst_port);
+  put_binary(data, probe_ttl);
+  put_binary(data, rtt);
+  const auto n_labels = std::min(reply_mpls_labels.size(), binary_mpls_labels);
+  put_binary(data, static_cast<uint8_t>(n_labels));
+  for (size_t i = 0; i < binary_mpls_labels; i++) {
+    uint32_t entry = 0;
+    if (i < n_labels) {
+      const auto& [label, exp, bos, ttl] = reply_mpls_labels[i];
+      entry = (label << 12) | ((exp & 0x7U) << 9) | ((bos & 0x1U) << 8) | ttl;
+    }
+    put_binary(data, entry);
+  }
+}
+
+Reply Reply::from_binary(const std::byte* data) {
+  Reply reply{};
+  reply.capture_timestamp = get_binary<int64_t>(data);
+  get_binary(data, reply.reply_src_addr);
+  get_binary(data, reply.reply_dst_addr);
+  reply.reply_id = get_binary<uint16_t>(data);
+  reply.reply_size = get_binary<uint16_t>(data);
+  reply.reply_ttl = get_binary<uint8_t>(data);
+  reply.reply_protocol = get_binary<uint8_t>(data);
+  reply.reply_icmp_type = get_binary<uint8_t>(data);
+  reply.reply_icmp_code = get_binary<uint8_t>(data);
+  get_binary(data, reply.probe_dst_addr);
+  reply.probe_id = get_binary<uint16_t>(data);
+  reply.probe_flow_label = get_binary<uint32_t>(data);
+  reply.probe_size = get_binary<uint16_t>(data);
+  reply.probe_protocol = get_binary<uint8_t>(data);
+  reply.quoted_ttl = get_binary<uint8_t>(data);
+  reply.probe_src_port = get_binary<uint16_t>(data);
+  reply.probe_dst_port = get_binary<uint16_t>(data);
+  reply.probe_ttl = get_binary<uint8_t>(data);
+  reply.rtt = get_binary<uint16_t>(data);
+  const auto n_labels = get_binary<uint8_t>(data);
+  if (n_labels > binary_mpls_labels) {
+    throw std::invalid_argument("Invalid number of MPLS labels: " +
+                                std::to_string(n_labels));
+  }
+  for (size_t i = 0; i < binary_mpls_labels; i++) {
+    const auto entry = get_binary<uint32_t>(data);
+    if (i < n_labels) {
+      reply.reply_mpls_labels.emplace_back(
+          entry >> 12, (entry >> 9) & 0x7U, (entry >> 8) & 0x1U, entry & 0xFFU);
+    }
+  }
+  return reply;
+}
+
 uint16_t Reply::checksum(uint32_t caracal_id) const {
   // TODO: IPv6 support? Or just encode the last 32 bits for IPv6?
   return Checksum::caracal_checksum(caracal_id, probe_dst_addr.s6_addr32[3],
@@ -0,0 +1,64 @@
+#include <array>
+#include <caracal/reply.hpp>
+#include <caracal/reply_sink.hpp>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace caracal {
+
+CsvSink::CsvSink(std::ostream &os) : os_{os} {
+  os_ << (Reply::csv_header() + "\n");
+}
+
+void CsvSink::write(const Reply &reply, const std::string &round) {
+  os_ << (reply.to_csv(round) + "\n");
+}
+
+void CsvSink::flush() { os_.flush(); }
+
+BinarySink::BinarySink(std::ostream &os) : os_{os} {}
+
+void BinarySink::write(const Reply &reply, const std::string &) {
+  std::array<std::byte, Reply::binary_size> buffer{};
+  reply.to_binary(buffer.data());
+  os_.write(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+}
+
+void BinarySink::flush() { os_.flush(); }
+
+CallbackSink::CallbackSink(Callback callback)
+    : callback_{std::move(callback)} {}
+
+void CallbackSink::write(const Reply &reply, const std::string &round) {
+  callback_(reply, round);
+}
+
+SynchronizedSink::SynchronizedSink(std::shared_ptr<ReplySink> sink)
+    : sink_{std::move(sink)} {}
+
+void SynchronizedSink::write(const Reply &reply, const std::string &round) {
+  std::scoped_lock lock{mutex_};
+  sink_->write(reply, round);
+}
+
+void SynchronizedSink::flush() {
+  std::scoped_lock lock{mutex_};
+  sink_->flush();
+}
+
+std::shared_ptr<ReplySink> make_sink(const std::string &format,
+                                     std::ostream &os) {
+  if (format == "csv") {
+    return std::make_shared<CsvSink>(os);
+  } else if (format == "binary") {
+    return std::make_shared<BinarySink>(os);
+  } else {
+    throw std::invalid_argument(format + " is not a valid output format");
+  }
+}
+
+}  // namespace caracal
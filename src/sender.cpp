@@ -1,17 +1,30 @@
 #include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#ifdef __linux__
+#include <linux/errqueue.h>
+#include <linux/if_packet.h>
+#include <linux/net_tstamp.h>
+#endif
 #include <netinet/in.h>
 #include <netinet/ip.h>
 #include <pcap/pcap.h>
 #include <spdlog/fmt/ostr.h>
 #include <spdlog/spdlog.h>
 #include <tins/tins.h>
+#include <array>
+#include <cerrno>
 #include <chrono>
+#include <cstring>
+#include <optional>
 #include <string>
+#include <system_error>
 
 
 #include <algorithm>
 #include <caracal/builder.hpp>
 #include <caracal/constants.hpp>
+#include <caracal/parser.hpp>
 #include <caracal/pretty.hpp>
 #include <caracal/probe.hpp>
 #include <caracal/sender.hpp>
@@ -19,6 +32,8 @@
 #include <caracal/utilities.hpp>
 #include <caracal/prober.hpp>
 
+using std::chrono::nanoseconds;
+using std::chrono::seconds;
 using std::chrono::system_clock;
 
 namespace caracal {
@@ -26,22 +41,59 @@ namespace caracal {
 Sender::Sender(const Prober::Config& config)
     : buffer_{},
       l2_protocol_{Protocols::L2::Ethernet},
+      send_functions_{},
       src_mac_{},
-      dst_mac_{},
+      dst_mac_v4_{},
+      dst_mac_v6_{},
       src_ip_v4_{},
       src_ip_v6_{},
       caracal_id_{config.caracal_id},
-      handle_{nullptr} {
+      tx_timestamps_{false},
+      handle_{nullptr, &pcap_close} {
   // Open pcap interface.
+  // The handle is closed on destruction, and if the constructor throws.
   char pcap_err[PCAP_ERRBUF_SIZE] = {};
-  handle_ = pcap_open_live(config.interface.c_str(), 0, 0, 0, pcap_err);
-  if (handle_ == nullptr) {
+  handle_.reset(pcap_open_live(config.interface.c_str(), 0, 0, 0, pcap_err));
+  if (!handle_) {
     throw std::runtime_error(pcap_err);
   } else if (strlen(pcap_err) > 0) {
     spdlog::warn("{}", pcap_err);
   }
 
-  switch (pcap_datalink(handle_)) {
+  if (config.qdisc_bypass) {
+#ifdef PACKET_QDISC_BYPASS
+    const int one = 1;
+    if (setsockopt(pcap_fileno(handle_.get()), SOL_PACKET,
+                   PACKET_QDISC_BYPASS, &one, sizeof(one)) < 0) {
+      const auto error = errno;
+      throw std::system_error(error, std::generic_category(),
+                              "PACKET_QDISC_BYPASS");
+    }
+    spdlog::info("sender_qdisc_bypass=1");
+#else
+    spdlog::warn("qdisc bypass is not supported on this platform");
+#endif
+  }
+
+  if (config.tx_timestamps) {
+#ifdef SO_TIMESTAMPING
+    // The kernel loops the probes back to the error queue of the socket,
+    // with the time at which they were handed to the device driver.
+    const int flags = SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if (setsockopt(pcap_fileno(handle_.get()), SOL_SOCKET, SO_TIMESTAMPING,
+                   &flags, sizeof(flags)) < 0) {
+      const auto error = errno;
+      throw std::system_error(error, std::generic_category(),
+                              "SO_TIMESTAMPING");
+    }
+    tx_timestamps_ = true;
+    spdlog::info("sender_tx_timestamps=1");
+#else
+    spdlog::warn("Transmit timestamps are not supported on this platform");
+#endif
+  }
+
+  switch (pcap_datalink(handle_.get())) {
     case DLT_EN10MB:
       l2_protocol_ = Protocols::L2::Ethernet;
       break;
@@ -54,28 +106,59 @@ Sender::Sender(const Prober::Config& config)
     default:
       throw std::runtime_error("Unsupported link type");
   }
+  switch (l2_protocol_) {
+    case Protocols::L2::BSDLoopback:
+      send_functions_ = send_functions<Protocols::L2::BSDLoopback>();
+      break;
+    case Protocols::L2::Ethernet:
+      send_functions_ = send_functions<Protocols::L2::Ethernet>();
+      break;
+    case Protocols::L2::None:
+      send_functions_ = send_functions<Protocols::L2::None>();
+      break;
+  }
 
-  // Find the IPv4/v6 gateway.
+  // Find the IPv4 and IPv6 gateways, so that a single sender can send a
+  // mixed stream of IPv4 and IPv6 probes.
   Tins::NetworkInterface interface { config.interface };
-  Tins::HWAddress<6> gateway_mac{"00:00:00:00:00:00"};
   if (l2_protocol_ == Protocols::L2::Ethernet) {
-    spdlog::info("Resolving the gateway MAC address...");
-    if (config.ip_version == 6) {
-      // TODO Libtins does not provide a simple way to get the HW gateway for IPv6,
-      // so let the user put their own gateway as a future work
-      // TODO In the future it might be best to resolve both gateway automatically
-      // and use them depending on the probe protocol. E.g. set gateway_mac_v4 and gateway_mac_v6
-      gateway_mac =
-          Utilities::gateway_mac_for(interface, Tins::IPv4Address("8.8.8.8"));
-    } else {
-      // By default use IPv4
-      gateway_mac =
-          Utilities::gateway_mac_for(interface, Tins::IPv4Address("8.8.8.8"));
+    spdlog::info("Resolving the gateway MAC addresses...");
+    std::optional<Tins::HWAddress<6>> gateway_mac_v4;
+    std::optional<Tins::HWAddress<6>> gateway_mac_v6;
+    if (config.ip_version != 4) {
+      try {
+        gateway_mac_v6 = Utilities::gateway_mac_v6_for(interface);
+      } catch (const std::exception& e) {
+        spdlog::warn("gateway_v6 error={}", e.what());
+      }
+    }
+    // Hosts without an IPv6 route in the neighbor table (or not on Linux)
+    // usually share the same router for IPv4 and IPv6: the IPv4 gateway is
+    // also resolved as a fallback in IPv6-only mode.
+    if (config.ip_version != 6 || !gateway_mac_v6) {
+      try {
+        gateway_mac_v4 = Utilities::gateway_mac_for(
+            interface, Tins::IPv4Address("8.8.8.8"));
+      } catch (const std::exception& e) {
+        spdlog::warn("gateway_v4 error={}", e.what());
+      }
+    }
+    if (!gateway_mac_v4 && !gateway_mac_v6) {
+      throw std::runtime_error("Unable to resolve the gateway MAC address");
     }
+    if (!gateway_mac_v6) {
+      spdlog::warn("IPv6 gateway not found, using the IPv4 gateway");
+      gateway_mac_v6 = gateway_mac_v4;
+    }
+    if (!gateway_mac_v4) {
+      gateway_mac_v4 = gateway_mac_v6;
+    }
+    std::copy(gateway_mac_v4->begin(), gateway_mac_v4->end(),
+              dst_mac_v4_.begin());
+    std::copy(gateway_mac_v6->begin(), gateway_mac_v6->end(),
+              dst_mac_v6_.begin());
   }
 
-  std::copy(gateway_mac.begin(), gateway_mac.end(), dst_mac_.begin());
-
 
   // Set the source/destination MAC addresses.
   auto if_mac = interface.hw_address();
@@ -102,70 +185,140 @@ Sender::Sender(const Prober::Config& config)
   }
 
 
-  spdlog::info("dst_mac={:02x}", fmt::join(dst_mac_, ":"));
+  spdlog::info("dst_mac_v4={:02x} dst_mac_v6={:02x}",
+               fmt::join(dst_mac_v4_, ":"), fmt::join(dst_mac_v6_, ":"));
   spdlog::info("src_ip_v4={} src_ip_v6={}", src_ip_v4_.sin_addr,
                src_ip_v6_.sin6_addr);
 }
 
-Sender::~Sender() { pcap_close(handle_); }
-
-void Sender::send(const Probe &probe) {
-  const auto l3_protocol = probe.l3_protocol();
-  const auto l4_protocol = probe.l4_protocol();
-
-  const uint64_t timestamp =
-      Timestamp::cast<Timestamp::tenth_ms>(system_clock::now());
-  const uint16_t timestamp_enc = Timestamp::encode(timestamp);
-
-  const uint16_t payload_length = probe.ttl + PAYLOAD_TWEAK_BYTES;
-  const Packet packet{buffer_.data(), buffer_.size(), l2_protocol_,
-                      l3_protocol,    l4_protocol,    payload_length};
-
-  std::fill(packet.begin(), packet.end(), std::byte{0});
-
+size_t Sender::read_tx_timestamps(const TxTimestampCallback &callback) {
+  if (!tx_timestamps_) {
+    return 0;
+  }
+#ifdef SO_TIMESTAMPING
+  size_t l2_size = 0;
   switch (l2_protocol_) {
     case Protocols::L2::BSDLoopback:
-      Builder::Loopback::init(packet);
+      l2_size = sizeof(uint32_t);
       break;
-
     case Protocols::L2::Ethernet:
-      Builder::Ethernet::init(packet, src_mac_, dst_mac_);
+      l2_size = sizeof(ether_header);
       break;
-
     case Protocols::L2::None:
       break;
   }
 
-  switch (l3_protocol) {
-    case Protocols::L3::IPv4:
-      Builder::IPv4::init(packet, src_ip_v4_.sin_addr,
-                          probe.sockaddr4().sin_addr, probe.ttl,
-                          probe.checksum(caracal_id_));
-      break;
-
-    case Protocols::L3::IPv6:
-      Builder::IPv6::init(packet, src_ip_v6_.sin6_addr,
-                          probe.sockaddr6().sin6_addr, probe.ttl,
-                          probe.flow_label);
+  std::array<std::byte, 2048> data{};
+  std::array<char, 512> control{};
+  size_t count = 0;
+  while (true) {
+    iovec iov{data.data(), data.size()};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+    const auto n =
+        recvmsg(pcap_fileno(handle_.get()), &msg, MSG_ERRQUEUE | MSG_DONTWAIT);
+    if (n < 0) {
+      // EAGAIN: the error queue is empty.
       break;
+    }
+    std::optional<nanoseconds> timestamp;
+    for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (cmsg->cmsg_level == SOL_SOCKET &&
+          cmsg->cmsg_type == SCM_TIMESTAMPING) {
+        scm_timestamping timestamps{};
+        std::memcpy(&timestamps, CMSG_DATA(cmsg), sizeof(timestamps));
+        // The software timestamp is the first one.
+        timestamp = seconds{timestamps.ts[0].tv_sec} +
+                    nanoseconds{timestamps.ts[0].tv_nsec};
+      }
+    }
+    if (!timestamp || static_cast<size_t>(n) <= l2_size) {
+      continue;
+    }
+    const auto probe = Parser::parse_probe(data.data() + l2_size, n - l2_size);
+    if (probe) {
+      callback(*probe, *timestamp);
+      count++;
+    }
   }
+  return count;
+#else
+  (void)callback;
+  return 0;
+#endif
+}
 
-  switch (l4_protocol) {
-    case Protocols::L4::ICMP:
-      Builder::ICMP::init(packet, probe.src_port, timestamp_enc);
-      break;
+bool Sender::tx_timestamps() const noexcept { return tx_timestamps_; }
 
-    case Protocols::L4::ICMPv6:
-      Builder::ICMPv6::init(packet, probe.src_port, timestamp_enc);
-      break;
+std::vector<in6_addr> Sender::source_addresses() const {
+  in6_addr src_ip_v4_mapped{};
+  src_ip_v4_mapped.s6_addr16[5] = 0xFFFF;
+  src_ip_v4_mapped.s6_addr32[3] = src_ip_v4_.sin_addr.s_addr;
+  return {src_ip_v4_mapped, src_ip_v6_.sin6_addr};
+}
 
-    case Protocols::L4::UDP:
-      Builder::UDP::init(packet, timestamp_enc, probe.src_port, probe.dst_port);
-      break;
+void Sender::send(const Probe &probe) {
+  const uint64_t timestamp =
+      Timestamp::cast<Timestamp::tenth_ms>(system_clock::now());
+  const uint16_t timestamp_enc = Timestamp::encode(timestamp);
+  const auto l3 = static_cast<size_t>(probe.l3_protocol());
+  const auto l4 = static_cast<size_t>(probe.l4_protocol());
+  (this->*send_functions_[l3][l4])(probe, timestamp_enc);
+}
+
+template <Protocols::L2 L2, Protocols::L3 L3, Protocols::L4 L4>
+void Sender::send(const Probe &probe, const uint16_t timestamp_enc) {
+  const uint16_t payload_length = probe.ttl + PAYLOAD_TWEAK_BYTES;
+  const Packet packet{buffer_.data(), buffer_.size(), Layout<L2, L3, L4>{},
+                      payload_length};
+
+  std::fill(packet.begin(), packet.end(), std::byte{0});
+
+  if constexpr (L2 == Protocols::L2::BSDLoopback) {
+    Builder::Loopback::init(packet);
+  } else if constexpr (L2 == Protocols::L2::Ethernet) {
+    Builder::Ethernet::init(
+        packet, src_mac_, L3 == Protocols::L3::IPv4 ? dst_mac_v4_ : dst_mac_v6_);
   }
 
-  if (pcap_inject(handle_, packet.l2(), packet.l2_size()) == PCAP_ERROR) {
-    throw std::runtime_error(pcap_geterr(handle_));
+  if constexpr (L3 == Protocols::L3::IPv4) {
+    Builder::IPv4::init(packet, src_ip_v4_.sin_addr,
+                        probe.sockaddr4().sin_addr, probe.ttl,
+                        probe.checksum(caracal_id_));
+  } else {
+    Builder::IPv6::init(packet, src_ip_v6_.sin6_addr,
+                        probe.sockaddr6().sin6_addr, probe.ttl,
+                        probe.flow_label);
+  }
+
+  if constexpr (L4 == Protocols::L4::ICMP) {
+    Builder::ICMP::init(packet, probe.src_port, timestamp_enc);
+  } else if constexpr (L4 == Protocols::L4::ICMPv6) {
+    Builder::ICMPv6::init(packet, probe.src_port, timestamp_enc);
+  } else {
+    Builder::UDP::init(packet, timestamp_enc, probe.src_port, probe.dst_port);
+  }
+
+  if (pcap_inject(handle_.get(), packet.l2(), packet.l2_size()) == PCAP_ERROR) {
+    throw std::runtime_error(pcap_geterr(handle_.get()));
   }
 }
+
+template <Protocols::L2 L2>
+Sender::SendFunctions Sender::send_functions() {
+  using Protocols::L3;
+  using Protocols::L4;
+  // Same order as the enumerations.
+  return {{{&Sender::send<L2, L3::IPv4, L4::ICMP>,
+            &Sender::send<L2, L3::IPv4, L4::ICMPv6>,
+            &Sender::send<L2, L3::IPv4, L4::UDP>},
+           {&Sender::send<L2, L3::IPv6, L4::ICMP>,
+            &Sender::send<L2, L3::IPv6, L4::ICMPv6>,
+            &Sender::send<L2, L3::IPv6, L4::UDP>}}};
+}
+
 }  // namespace caracal
@@ -0,0 +1,215 @@
+#include <fcntl.h>
+#include <spdlog/spdlog.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <caracal/reply.hpp>
+#include <caracal/shm_ring.hpp>
+#include <cerrno>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+namespace caracal {
+
+namespace {
+
+constexpr uint64_t ring_magic = 0x474e4952'4c524343;  // "CCRLRING"
+constexpr uint32_t ring_version = 1;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "the ring requires lock-free 64-bit atomics");
+
+/// Beginning of the shared-memory object, followed by `capacity` slots.
+/// The write sequence is on its own cache line to avoid false sharing with
+/// the (read-only) metadata.
+struct RingHeader {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t capacity;
+  uint64_t slot_size;
+  alignas(64) std::atomic<uint64_t> write_sequence;
+};
+
+/// Each slot starts with a seqlock: 2n + 1 while record n is being written,
+/// 2n + 2 once it is complete.
+constexpr uint64_t slot_size =
+    (sizeof(std::atomic<uint64_t>) + Reply::binary_size + 7) / 8 * 8;
+
+constexpr size_t ring_size(const uint64_t capacity) {
+  return sizeof(RingHeader) + capacity * slot_size;
+}
+
+template <typename T>
+auto header(T *data) {
+  return std::launder(reinterpret_cast<RingHeader *>(
+      const_cast<std::byte *>(data)));
+}
+
+template <typename T>
+auto slot_sequence(T *data, const uint64_t capacity, const uint64_t n) {
+  auto slot = data + sizeof(RingHeader) + (n & (capacity - 1)) * slot_size;
+  return std::launder(reinterpret_cast<std::atomic<uint64_t> *>(
+      const_cast<std::byte *>(slot)));
+}
+
+template <typename T>
+auto slot_record(T *data, const uint64_t capacity, const uint64_t n) {
+  return data + sizeof(RingHeader) + (n & (capacity - 1)) * slot_size +
+         sizeof(std::atomic<uint64_t>);
+}
+
+}  // namespace
+
+ShmRingSink::ShmRingSink(const std::string &name, const uint64_t capacity)
+    : name_{name}, data_{nullptr}, size_{0} {
+  if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+    throw std::invalid_argument("shm ring capacity must be a power of two");
+  }
+  size_ = ring_size(capacity);
+
+  const int fd = shm_open(name.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            "shm_open " + name);
+  }
+  if (ftruncate(fd, static_cast<off_t>(size_)) < 0) {
+    const auto error = errno;
+    close(fd);
+    shm_unlink(name.c_str());
+    throw std::system_error(error, std::generic_category(), "ftruncate");
+  }
+  auto ptr = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  // The mapping remains valid after the file descriptor is closed.
+  close(fd);
+  if (ptr == MAP_FAILED) {
+    const auto error = errno;
+    shm_unlink(name.c_str());
+    throw std::system_error(error, std::generic_category(), "mmap");
+  }
+  data_ = static_cast<std::byte *>(ptr);
+
+  // The object is zero-filled by ftruncate, we only need to start the
+  // lifetime of the atomics.
+  for (uint64_t i = 0; i < capacity; i++) {
+    new (data_ + sizeof(RingHeader) + i * slot_size) std::atomic<uint64_t>{0};
+  }
+  auto hdr = new (data_) RingHeader{};
+  hdr->version = ring_version;
+  hdr->record_size = Reply::binary_size;
+  hdr->capacity = capacity;
+  hdr->slot_size = slot_size;
+  hdr->write_sequence.store(0, std::memory_order_relaxed);
+  // Publish the magic last, so that a consumer never attaches to a ring
+  // that is partially initialized.
+  std::atomic_thread_fence(std::memory_order_release);
+  hdr->magic = ring_magic;
+
+  spdlog::info("shm_ring={} capacity={} size={}", name_, capacity, size_);
+}
+
+ShmRingSink::~ShmRingSink() {
+  munmap(data_, size_);
+  shm_unlink(name_.c_str());
+}
+
+void ShmRingSink::write(const Reply &reply, const std::string &) {
+  auto hdr = header(data_);
+  const auto n = hdr->write_sequence.load(std::memory_order_relaxed);
+  auto sequence = slot_sequence(data_, hdr->capacity, n);
+  sequence->store(2 * n + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  reply.to_binary(slot_record(data_, hdr->capacity, n));
+  sequence->store(2 * n + 2, std::memory_order_release);
+  hdr->write_sequence.store(n + 1, std::memory_order_release);
+}
+
+uint64_t ShmRingSink::sequence() const noexcept {
+  return header(data_)->write_sequence.load(std::memory_order_relaxed);
+}
+
+ShmRingReader::ShmRingReader(const std::string &name)
+    : data_{nullptr}, size_{0}, sequence_{0}, overruns_{0} {
+  const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            "shm_open " + name);
+  }
+  struct stat st {};
+  if (fstat(fd, &st) < 0) {
+    const auto error = errno;
+    close(fd);
+    throw std::system_error(error, std::generic_category(), "fstat");
+  }
+  size_ = static_cast<size_t>(st.st_size);
+  if (size_ < sizeof(RingHeader)) {
+    close(fd);
+    throw std::runtime_error(name + " is not a caracal ring");
+  }
+  auto ptr = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (ptr == MAP_FAILED) {
+    throw std::system_error(errno, std::generic_category(), "mmap");
+  }
+  data_ = static_cast<const std::byte *>(ptr);
+
+  const auto hdr = header(data_);
+  if (hdr->magic != ring_magic || hdr->version != ring_version ||
+      hdr->record_size != Reply::binary_size || hdr->slot_size != slot_size ||
+      size_ != ring_size(hdr->capacity)) {
+    munmap(const_cast<std::byte *>(data_), size_);
+    throw std::runtime_error(name + " is not a caracal ring");
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  sequence_ = hdr->write_sequence.load(std::memory_order_acquire);
+}
+
+ShmRingReader::~ShmRingReader() {
+  munmap(const_cast<std::byte *>(data_), size_);
+}
+
+bool ShmRingReader::read(Reply &reply) {
+  const auto hdr = header(data_);
+  const auto capacity = hdr->capacity;
+  std::array<std::byte, Reply::binary_size> buffer{};
+
+  while (true) {
+    const auto written = hdr->write_sequence.load(std::memory_order_acquire);
+    if (sequence_ == written) {
+      return false;
+    }
+    // The producer has lapped us, skip to the oldest record still available.
+    if (written - sequence_ > capacity) {
+      overruns_ += written - sequence_ - capacity;
+      sequence_ = written - capacity;
+    }
+
+    const auto sequence = slot_sequence(data_, capacity, sequence_);
+    const auto before = sequence->load(std::memory_order_acquire);
+    if (before == 2 * sequence_ + 2) {
+      std::copy_n(slot_record(data_, capacity, sequence_), buffer.size(),
+                  buffer.begin());
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (sequence->load(std::memory_order_relaxed) == before) {
+        sequence_++;
+        reply = Reply::from_binary(buffer.data());
+        return true;
+      }
+    }
+    // The slot is being overwritten by a newer record.
+    overruns_++;
+    sequence_++;
+  }
+}
+
+uint64_t ShmRingReader::sequence() const noexcept { return sequence_; }
+
+uint64_t ShmRingReader::overruns() const noexcept { return overruns_; }
+
+}  // namespace caracal
@@ -1,53 +1,164 @@
+#include <sys/socket.h>
 #include <spdlog/fmt/fmt.h>
 #include <spdlog/fmt/ostr.h>
 #include <spdlog/spdlog.h>
 #include <tins/tins.h>
 
+#include <caracal/feedback.hpp>
 #include <caracal/parser.hpp>
+#include <caracal/reply_sink.hpp>
 #include <caracal/sniffer.hpp>
 #include <caracal/statistics.hpp>
 #include <caracal/utilities.hpp>
+#include <cerrno>
+#include <algorithm>
+#include <bit>
 #include <chrono>
+#include <cstring>
 #include <filesystem>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <ostream>
+#include <string>
+#include <system_error>
 #include <thread>
+#include <utility>
 
 namespace fs = std::filesystem;
 
+using std::chrono::steady_clock;
+
 namespace caracal {
 
+namespace {
+
+/// Destination address filter for one IP version.
+std::string dst_hosts(const std::vector<in6_addr> &addresses, bool ipv4) {
+  std::string filter;
+  for (const auto &address : addresses) {
+    if (static_cast<bool>(IN6_IS_ADDR_V4MAPPED(&address)) == ipv4) {
+      filter += (filter.empty() ? "" : " or ") + std::string{"dst host "} +
+                Utilities::format_addr(address);
+    }
+  }
+  return filter.empty() ? "" : " and (" + filter + ")";
+}
+
+/// Compare the quoted IP ID with the caracal checksum of the quoted probe,
+/// see Checksum::caracal_checksum and Parser::parse.
+/// The quoted IP header starts at icmp[8], its destination is read in host
+/// byte order. The sum is computed modulo 65535, which fits in the 32-bit
+/// BPF registers: a 32-bit word is congruent to the sum of its halves.
+std::string checksum_filter(uint16_t caracal_id) {
+  const auto dst = std::endian::native == std::endian::little
+                       ? "icmp[27] * 256 + icmp[26] + icmp[25] * 256 + "
+                         "icmp[24]"
+                       : "icmp[24:2] + icmp[26:2]";
+  const auto checksum = [&](const std::string &src_port,
+                            const std::string &ttl) {
+    return fmt::format("icmp[12:2] = 65535 - (({} + {} + {} + {}) % 65535)",
+                       caracal_id, dst, src_port, ttl);
+  };
+  // The TTL of the probe is encoded in the payload length.
+  return fmt::format(
+      " and ((icmp[8] & 0xf) != 5"
+      " or (icmp[17] = 1 and {})"
+      " or (icmp[17] = 17 and {}))",
+      checksum("icmp[32:2]", "((icmp[10:2] - 30) & 0xff)"),
+      checksum("icmp[28:2]", "((icmp[32:2] - 10) & 0xff)"));
+}
+
+}  // namespace
+
+CaptureSettings capture_settings(const uint64_t reply_rate,
+                                 const std::optional<int> busy_poll) {
+  constexpr uint64_t mib = 1024 * 1024;
+  CaptureSettings settings{};
+  // Two seconds of replies, with ~256 bytes per reply (an ICMPv6 time
+  // exceeded message quoting the probe, and the TPACKET headers).
+  const auto buffer_size = std::clamp<uint64_t>(
+      reply_rate * 2 * 256, CaptureSettings::min_buffer_size,
+      CaptureSettings::max_buffer_size);
+  settings.buffer_size = (buffer_size + mib - 1) / mib * mib;
+  if (busy_poll) {
+    // The deliveries are not batched when busy polling.
+    settings.timeout = 1;
+    settings.busy_poll = busy_poll;
+  } else if (reply_rate <= 10'000) {
+    // The wakeups are cheap at low rates, and the replies are processed
+    // (written, fed back to the stop set, ...) as soon as they arrive.
+    settings.immediate_mode = true;
+  } else {
+    // The buffer blocks are delivered when full, and the timeout only delays
+    // the tail of the replies: wait for ~1000 replies.
+    settings.timeout =
+        static_cast<int>(std::clamp<uint64_t>(1'000'000 / reply_rate, 10, 100));
+  }
+  return settings;
+}
+
+std::ostream &operator<<(std::ostream &os, CaptureSettings const &v) {
+  os << "sniffer_buffer_size=" << v.buffer_size;
+  os << " sniffer_timeout=" << v.timeout << "ms";
+  os << " sniffer_immediate_mode=" << v.immediate_mode;
+  return os;
+}
+
+std::string SnifferFilter::to_string() const {
+  std::string errors_v4 =
+      "(icmp[icmptype] = icmp-timxceed or "
+      "icmp[icmptype] = icmp-unreach)";
+  std::string errors_v6 =
+      "(icmp6[icmp6type] = icmp6-timeexceeded or "
+      "icmp6[icmp6type] = icmp6-destinationunreach)";
+  if (quoted_protocols) {
+    errors_v4 = "(" + errors_v4 + " and (icmp[17] = 1 or icmp[17] = 17))";
+    errors_v6 = "(" + errors_v6 + " and (icmp6[14] = 58 or icmp6[14] = 17))";
+  }
+  if (caracal_id) {
+    errors_v4 = "(" + errors_v4 + checksum_filter(*caracal_id) + ")";
+  }
+  return "(ip and icmp" + dst_hosts(addresses, true) +
+         " and (icmp[icmptype] = icmp-echoreply or " + errors_v4 + "))" +
+         " or (ip6 and icmp6" + dst_hosts(addresses, false) +
+         " and (icmp6[icmp6type] = icmp6-echoreply or " + errors_v6 + "))";
+}
+
 Sniffer::Sniffer(const std::string &interface_name,
                  const std::optional<std::string> &meta_round,
-                 const uint16_t caracal_id, const bool integrity_check)
+                 const uint16_t caracal_id, const bool integrity_check,
+                 const CaptureSettings &settings, const SnifferFilter &filter)
     : sniffer_{interface_name},
+      interface_name_{interface_name},
+      filter_{filter.to_string()},
+      settings_{settings},
+      closed_pcap_statistics_{},
+      link_type_{DLT_EN10MB},
       meta_round_{meta_round},
+      sink_{},
+      feedback_{},
+      stopped_{false},
       statistics_{},
+      rtt_histogram_{},
+      last_reply_time_{0},
+      replies_count_{0},
       caracal_id_{caracal_id},
       integrity_check_{integrity_check} {
   Tins::NetworkInterface interface { interface_name };
+  spdlog::info("sniffer_filter={}", filter_);
+  open();
+}
 
-  auto filter =
-      "(ip and icmp and ("
-      "icmp[icmptype] = icmp-echoreply or "
-      "icmp[icmptype] = icmp-timxceed or "
-      "icmp[icmptype] = icmp-unreach))"
-      " or "
-      "(ip6 and icmp6 and ("
-      "icmp6[icmp6type] = icmp6-echoreply or "
-      "icmp6[icmp6type] = icmp6-timeexceeded or "
-      "icmp6[icmp6type] = icmp6-destinationunreach))";
-  spdlog::info("sniffer_filter={}", filter);
-
+void Sniffer::open() {
   Tins::SnifferConfiguration config;
-  // A buffer of 64M is enough to store ~1M ICMPv6 Time Exceeded replies.
-  // We probably don't need as much but this lets us handle burst of incoming
-  // packets.
-  config.set_buffer_size(64 * 1024 * 1024);
+  // See `capture_settings` for the choice of the buffer size.
+  config.set_buffer_size(settings_.buffer_size);
   // Filter as much as possible at the kernel level.
   // We're only interested in incoming ICMP packets.
   config.set_direction(PCAP_D_IN);
-  config.set_filter(filter);
+  config.set_filter(filter_);
   // `timeout` has two uses here:
   // 1. Batch deliveries from pcap to reduce syscall overhead
   //    See "packet buffer timeout" in PCAP(3PCAP) man page.
@@ -56,8 +167,34 @@ Sniffer::Sniffer(const std::string &interface_name,
   // 2. Allow us to break the capture loop through the `stopped` variable.
   // This has no impact of RTT computation as packets are timestamped as soon as
   // they are captured by pcap.
-  config.set_timeout(100);
-  sniffer_ = Tins::Sniffer(interface_name, config);
+  config.set_timeout(settings_.timeout);
+  config.set_immediate_mode(settings_.immediate_mode);
+  // The previous handle is only replaced once the new one is set up.
+  Tins::Sniffer sniffer{interface_name_, config};
+
+  if (settings_.busy_poll) {
+#ifdef SO_BUSY_POLL
+    const int fd = pcap_fileno(sniffer.get_pcap_handle());
+    const int usecs = *settings_.busy_poll;
+    if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &usecs, sizeof(usecs)) < 0) {
+      throw std::system_error(errno, std::generic_category(), "SO_BUSY_POLL");
+    }
+#ifdef SO_PREFER_BUSY_POLL
+    const int prefer = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &prefer,
+                   sizeof(prefer)) < 0) {
+      spdlog::warn("SO_PREFER_BUSY_POLL error={}", std::strerror(errno));
+    }
+#endif
+    spdlog::info("sniffer_busy_poll={}us", usecs);
+#else
+    spdlog::warn("Busy polling is not supported on this platform");
+#endif
+  }
+
+  sniffer_ = std::move(sniffer);
+  link_type_ = pcap_datalink(sniffer_.get_pcap_handle());
+  spdlog::info(settings_);
 }
 
 Sniffer::~Sniffer() {
@@ -67,49 +204,159 @@ Sniffer::~Sniffer() {
 }
 
 void Sniffer::start() noexcept {
-  std::cout << (Reply::csv_header() + "\n");
-  auto handler = [this](Tins::Packet &packet) {
-    auto reply = Parser::parse(packet);
-
-    if (reply && (!integrity_check_ || reply->is_valid(caracal_id_))) {
-      spdlog::trace(reply.value());
-      statistics_.icmp_messages_all.insert(reply->reply_src_addr);
-      if (reply->is_time_exceeded()) {
-        statistics_.icmp_messages_path.insert(reply->reply_src_addr);
+  stopped_ = false;
+  // The frames are read with pcap_dispatch rather than Tins::Sniffer, to copy
+  // the raw frames to the pcap writer without serializing the PDUs again.
+  thread_ = std::thread([this]() {
+    auto handle = sniffer_.get_pcap_handle();
+    auto callback = [](u_char *user, const pcap_pkthdr *header,
+                       const u_char *data) {
+      reinterpret_cast<Sniffer *>(user)->handle(*header, data);
+    };
+    while (!stopped_) {
+      const auto n = pcap_dispatch(handle, -1, callback,
+                                   reinterpret_cast<u_char *>(this));
+      if (n == PCAP_ERROR_BREAK) {
+        break;
+      }
+      if (n == PCAP_ERROR) {
+        spdlog::error("sniffer error={}", pcap_geterr(handle));
+        break;
       }
-      std::cout << (reply->to_csv(meta_round_.value_or("1")) + "\n");
-    } else {
-      auto data = packet.pdu()->serialize();
-      spdlog::trace("invalid_packet_hex={:02x}", fmt::join(data, ""));
-      statistics_.received_invalid_count++;
     }
+  });
+}
 
-    if (output_pcap_) {
-      output_pcap_->write(packet);
-    }
+void Sniffer::handle(const pcap_pkthdr &header, const u_char *data) {
+  if (pcap_writer_) {
+    pcap_writer_->write(header, data);
+  }
 
-    statistics_.received_count++;
-    return true;
-  };
+  // The malformed frames are counted as invalid.
+  const auto reply = Parser::parse(link_type_, header, data);
+
+  std::scoped_lock lock{sink_mutex_};
 
-  thread_ = std::thread([this, handler]() { sniffer_.sniff_loop(handler); });
+  if (reply && (!integrity_check_ || reply->is_valid(caracal_id_))) {
+    spdlog::trace(reply.value());
+    statistics_.observe(reply.value());
+    rtt_histogram_.push_back(reply->rtt);
+    last_reply_time_ = steady_clock::now().time_since_epoch().count();
+    replies_count_++;
+    if (feedback_) {
+      feedback_->observe(reply.value());
+    }
+    if (sink_) {
+      sink_->write(reply.value(), meta_round_.value_or("1"));
+    }
+  } else {
+    spdlog::trace("invalid_packet_hex={:02x}",
+                  fmt::join(data, data + header.caplen, ""));
+    statistics_.received_invalid_count++;
+  }
+
+  statistics_.received_count++;
 }
 
 void Sniffer::stop() noexcept {
   if (thread_.joinable()) {
+    stopped_ = true;
     sniffer_.stop_sniff();
     thread_.join();
   }
 }
 
+void Sniffer::set_sink(std::shared_ptr<ReplySink> sink) {
+  std::scoped_lock lock{sink_mutex_};
+  if (sink_) {
+    sink_->flush();
+  }
+  sink_ = std::move(sink);
+}
+
+void Sniffer::set_feedback(std::shared_ptr<Feedback> feedback) {
+  std::scoped_lock lock{sink_mutex_};
+  feedback_ = std::move(feedback);
+}
+
+void Sniffer::set_pcap_writer(std::shared_ptr<PcapWriter> writer) {
+  pcap_writer_ = std::move(writer);
+}
+
+const std::shared_ptr<PcapWriter> &Sniffer::pcap_writer() const noexcept {
+  return pcap_writer_;
+}
+
+void Sniffer::set_meta_round(const std::optional<std::string> &meta_round) {
+  std::scoped_lock lock{sink_mutex_};
+  meta_round_ = meta_round;
+}
+
+Statistics::Sniffer Sniffer::reset_statistics() {
+  std::scoped_lock lock{sink_mutex_};
+  replies_count_ = 0;
+  return std::exchange(statistics_, Statistics::Sniffer{});
+}
+
 const Statistics::Sniffer &Sniffer::statistics() const noexcept {
   return statistics_;
 }
 
+const Statistics::RttHistogram &Sniffer::rtt_histogram() const noexcept {
+  return rtt_histogram_;
+}
+
+steady_clock::time_point Sniffer::last_reply_time() const noexcept {
+  return steady_clock::time_point{steady_clock::duration{last_reply_time_}};
+}
+
+uint64_t Sniffer::replies_count() const noexcept { return replies_count_; }
+
 pcap_stat Sniffer::pcap_statistics() noexcept {
+  std::scoped_lock lock{capture_mutex_};
   pcap_stat ps{};
   pcap_stats(sniffer_.get_pcap_handle(), &ps);
+  ps.ps_recv += closed_pcap_statistics_.ps_recv;
+  ps.ps_drop += closed_pcap_statistics_.ps_drop;
+  ps.ps_ifdrop += closed_pcap_statistics_.ps_ifdrop;
   return ps;
 }
 
+void Sniffer::reopen(const CaptureSettings &settings) {
+  const bool running = thread_.joinable();
+  stop();
+  std::scoped_lock lock{capture_mutex_};
+  pcap_stat ps{};
+  pcap_stats(sniffer_.get_pcap_handle(), &ps);
+  const auto previous = settings_;
+  settings_ = settings;
+  try {
+    open();
+  } catch (...) {
+    settings_ = previous;
+    if (running) {
+      start();
+    }
+    throw;
+  }
+  // The counters of the new handle start from zero.
+  closed_pcap_statistics_.ps_recv += ps.ps_recv;
+  closed_pcap_statistics_.ps_drop += ps.ps_drop;
+  closed_pcap_statistics_.ps_ifdrop += ps.ps_ifdrop;
+  if (running) {
+    start();
+  }
+}
+
+CaptureSettings Sniffer::capture_settings() const noexcept {
+  std::scoped_lock lock{capture_mutex_};
+  return settings_;
+}
+
+int Sniffer::link_type() const noexcept { return link_type_; }
+
+std::thread::native_handle_type Sniffer::native_handle() noexcept {
+  return thread_.native_handle();
+}
+
 }  // namespace caracal
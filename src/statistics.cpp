@@ -1,7 +1,13 @@
+#include <netinet/in.h>
+
 #include <algorithm>
 #include <caracal/statistics.hpp>
 #include <chrono>
+#include <cmath>
+#include <optional>
 #include <ostream>
+#include <string>
+#include <utility>
 
 using std::chrono::nanoseconds;
 
@@ -30,14 +36,93 @@ double RateLimiter::average_rate() const noexcept {
   return average > 0 ? (steps_ * nanoseconds::period::den / average) : 0;
 }
 
+void RttHistogram::push_back(const uint16_t rtt) noexcept {
+  buckets_[rtt / bucket_width].fetch_add(1, std::memory_order_relaxed);
+  size_.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t RttHistogram::size() const noexcept {
+  return size_.load(std::memory_order_relaxed);
+}
+
+uint32_t RttHistogram::percentile(const double q) const noexcept {
+  const auto total = size();
+  if (total == 0) {
+    return 0;
+  }
+  const auto target = static_cast<uint64_t>(std::ceil(q * total));
+  uint64_t count = 0;
+  for (size_t i = 0; i < buckets_.size(); i++) {
+    count += buckets_[i].load(std::memory_order_relaxed);
+    if (count >= target) {
+      return (i + 1) * bucket_width;
+    }
+  }
+  return buckets_.size() * bucket_width;
+}
+
+namespace {
+
+/// Index of a protocol in the counters, 0 to 2 for the probes and 0 to 1
+/// for the replies.
+std::optional<size_t> protocol_index(const uint8_t protocol) noexcept {
+  switch (protocol) {
+    case IPPROTO_ICMP:
+      return 0;
+    case IPPROTO_ICMPV6:
+      return 1;
+    case IPPROTO_UDP:
+      return 2;
+    default:
+      return std::nullopt;
+  }
+}
+
+constexpr std::array<const char*, 3> protocol_names{"icmp", "icmp6", "udp"};
+
+}  // namespace
+
+void Sniffer::observe(const Reply& reply) {
+  icmp_messages_all.insert(reply.reply_src_addr);
+  if (reply.is_time_exceeded()) {
+    icmp_messages_path.insert(reply.reply_src_addr);
+  }
+  if (const auto probe = protocol_index(reply.probe_protocol)) {
+    replies_by_ttl.increment(*probe * 256 + reply.probe_ttl);
+  }
+  if (const auto protocol = protocol_index(reply.reply_protocol);
+      protocol && *protocol < 2) {
+    replies_by_icmp.increment(*protocol * 256 * 16 +
+                              reply.reply_icmp_type * 16 +
+                              std::min<uint8_t>(reply.reply_icmp_code, 15));
+  }
+}
+
+Sniffer& Sniffer::operator+=(const Sniffer& other) {
+  received_count += other.received_count;
+  received_invalid_count += other.received_invalid_count;
+  icmp_messages_all.insert(other.icmp_messages_all.begin(),
+                           other.icmp_messages_all.end());
+  icmp_messages_path.insert(other.icmp_messages_path.begin(),
+                            other.icmp_messages_path.end());
+  replies_by_ttl += other.replies_by_ttl;
+  replies_by_icmp += other.replies_by_icmp;
+  return *this;
+}
+
 std::ostream& operator<<(std::ostream& os, Prober const& v) {
   os << "probes_read=" << v.read;
   os << " packets_sent=" << v.sent;
   os << " packets_failed=" << v.failed;
+  os << " filtered_duplicate=" << v.filtered_duplicate;
   os << " filtered_low_ttl=" << v.filtered_lo_ttl;
   os << " filtered_high_ttl=" << v.filtered_hi_ttl;
   os << " filtered_prefix_excl=" << v.filtered_prefix_excl;
   os << " filtered_prefix_not_incl=" << v.filtered_prefix_not_incl;
+  os << " filtered_stop_set=" << v.filtered_stop_set;
+  os << " filtered_reached=" << v.filtered_reached;
+  os << " tx_timestamps=" << v.tx_timestamps;
+  os << " tx_timestamps_missing=" << v.tx_timestamps_missing;
   return os;
 }
 
@@ -52,6 +137,24 @@ std::ostream& operator<<(std::ostream& os, Sniffer const& v) {
   os << " packets_received_invalid=" << v.received_invalid_count;
   os << " icmp_distinct_incl_dest=" << v.icmp_messages_all.size();
   os << " icmp_distinct_excl_dest=" << v.icmp_messages_path.size();
+  // Only the non-zero counters, e.g. replies_by_ttl=icmp/1:10,icmp/2:8
+  // and replies_by_icmp=icmp/11/0:18 (protocol/type/code:count).
+  std::string separator;
+  os << " replies_by_ttl=";
+  for (size_t i = 0; i < v.replies_by_ttl.size(); i++) {
+    if (const auto count = v.replies_by_ttl[i]) {
+      os << std::exchange(separator, ",") << protocol_names[i / 256] << "/"
+         << i % 256 << ":" << count;
+    }
+  }
+  separator.clear();
+  os << " replies_by_icmp=";
+  for (size_t i = 0; i < v.replies_by_icmp.size(); i++) {
+    if (const auto count = v.replies_by_icmp[i]) {
+      os << std::exchange(separator, ",") << protocol_names[i / (256 * 16)]
+         << "/" << i / 16 % 256 << "/" << i % 16 << ":" << count;
+    }
+  }
   return os;
 }
 
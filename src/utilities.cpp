@@ -1,11 +1,27 @@
 #include <arpa/inet.h>
 #include <cxxabi.h>
 #include <ifaddrs.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/neighbour.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#endif
 #include <tins/tins.h>
 
 #include <caracal/constants.hpp>
 #include <caracal/utilities.hpp>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <optional>
 #include <string>
+#include <system_error>
+#include <thread>
 
 namespace caracal::Utilities {
 
@@ -37,6 +53,148 @@ Tins::HWAddress<6> gateway_mac_for(const Tins::NetworkInterface& interface,
   return Tins::Utils::resolve_hwaddr(gateway_ip, sender);
 }
 
+std::optional<in6_addr> default_gateway_ipv6(std::istream& routes,
+                                             const std::string& interface) {
+  // Columns: destination, destination prefix length, source, source prefix
+  // length, next hop, metric, reference count, use count, flags, device.
+  std::string dst, dst_len, src, src_len, next_hop, metric, refcnt, use, flags,
+      device;
+  std::optional<in6_addr> gateway;
+  uint32_t best_metric = UINT32_MAX;
+  while (routes >> dst >> dst_len >> src >> src_len >> next_hop >> metric >>
+         refcnt >> use >> flags >> device) {
+    const auto is_default = dst == std::string(32, '0') && dst_len == "00";
+    const auto has_gateway = next_hop != std::string(32, '0');
+    const auto m = static_cast<uint32_t>(std::stoul(metric, nullptr, 16));
+    if (is_default && has_gateway && device == interface && m < best_metric) {
+      in6_addr addr{};
+      for (size_t i = 0; i < 16; i++) {
+        addr.s6_addr[i] = static_cast<uint8_t>(
+            std::stoul(next_hop.substr(2 * i, 2), nullptr, 16));
+      }
+      gateway = addr;
+      best_metric = m;
+    }
+  }
+  return gateway;
+}
+
+#ifdef __linux__
+
+std::optional<in6_addr> gateway_ipv6_for(
+    const Tins::NetworkInterface& interface) {
+  std::ifstream routes{"/proc/net/ipv6_route"};
+  return default_gateway_ipv6(routes, interface.name());
+}
+
+namespace {
+
+/// Look up a neighbor in the kernel neighbor table (RTM_GETNEIGH dump).
+std::optional<Tins::HWAddress<6>> lookup_neighbor(const in6_addr& addr,
+                                                  const int ifindex) {
+  const int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(), "netlink");
+  }
+
+  struct {
+    nlmsghdr header;
+    ndmsg message;
+  } request{};
+  request.header.nlmsg_len = NLMSG_LENGTH(sizeof(ndmsg));
+  request.header.nlmsg_type = RTM_GETNEIGH;
+  request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+  request.message.ndm_family = AF_INET6;
+  if (send(fd, &request, request.header.nlmsg_len, 0) < 0) {
+    const auto error = errno;
+    close(fd);
+    throw std::system_error(error, std::generic_category(), "netlink");
+  }
+
+  std::optional<Tins::HWAddress<6>> mac;
+  std::array<char, 32768> buffer{};
+  bool done = false;
+  while (!done) {
+    auto len = recv(fd, buffer.data(), buffer.size(), 0);
+    if (len <= 0) {
+      break;
+    }
+    for (auto nh = reinterpret_cast<nlmsghdr*>(buffer.data());
+         NLMSG_OK(nh, static_cast<uint32_t>(len)); nh = NLMSG_NEXT(nh, len)) {
+      if (nh->nlmsg_type == NLMSG_DONE || nh->nlmsg_type == NLMSG_ERROR) {
+        done = true;
+        break;
+      }
+      const auto ndm = static_cast<const ndmsg*>(NLMSG_DATA(nh));
+      if (ndm->ndm_ifindex != ifindex ||
+          (ndm->ndm_state & (NUD_INCOMPLETE | NUD_FAILED))) {
+        continue;
+      }
+      const uint8_t* dst = nullptr;
+      const uint8_t* lladdr = nullptr;
+      auto rta_len = static_cast<int>(RTM_PAYLOAD(nh));
+      for (auto rta = reinterpret_cast<rtattr*>(
+               reinterpret_cast<char*>(NLMSG_DATA(nh)) +
+               NLMSG_ALIGN(sizeof(ndmsg)));
+           RTA_OK(rta, rta_len); rta = RTA_NEXT(rta, rta_len)) {
+        if (rta->rta_type == NDA_DST && RTA_PAYLOAD(rta) == 16) {
+          dst = static_cast<const uint8_t*>(RTA_DATA(rta));
+        } else if (rta->rta_type == NDA_LLADDR && RTA_PAYLOAD(rta) == 6) {
+          lladdr = static_cast<const uint8_t*>(RTA_DATA(rta));
+        }
+      }
+      if (dst && lladdr && std::memcmp(dst, &addr, 16) == 0) {
+        mac = Tins::HWAddress<6>{lladdr};
+      }
+    }
+  }
+  close(fd);
+  return mac;
+}
+
+}  // namespace
+
+std::optional<Tins::HWAddress<6>> gateway_mac_v6_for(
+    const Tins::NetworkInterface& interface) {
+  const auto gateway = gateway_ipv6_for(interface);
+  if (!gateway) {
+    return std::nullopt;
+  }
+  const auto ifindex = static_cast<int>(interface.id());
+  for (int attempt = 0; attempt < 10; attempt++) {
+    if (auto mac = lookup_neighbor(*gateway, ifindex)) {
+      return mac;
+    }
+    // Not in the neighbor table: send a datagram to the gateway (on the
+    // discard port), so that the kernel performs the neighbor discovery.
+    const int fd = socket(AF_INET6, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0) {
+      sockaddr_in6 sa{};
+      sa.sin6_family = AF_INET6;
+      sa.sin6_addr = *gateway;
+      sa.sin6_port = htons(9);
+      sa.sin6_scope_id = interface.id();
+      sendto(fd, nullptr, 0, 0, reinterpret_cast<sockaddr*>(&sa), sizeof(sa));
+      close(fd);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds{100});
+  }
+  return std::nullopt;
+}
+
+#else
+
+std::optional<in6_addr> gateway_ipv6_for(const Tins::NetworkInterface&) {
+  return std::nullopt;
+}
+
+std::optional<Tins::HWAddress<6>> gateway_mac_v6_for(
+    const Tins::NetworkInterface&) {
+  return std::nullopt;
+}
+
+#endif
+
 std::string format_addr(const in6_addr& addr) noexcept {
   char buf[INET6_ADDRSTRLEN] = {};
   if (IN6_IS_ADDR_V4MAPPED(&addr)) {
@@ -0,0 +1,75 @@
+#include <pthread.h>
+
+#include <caracal/affinity.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <optional>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+using caracal::Affinity::format_cpu_list;
+using caracal::Affinity::numa_node_cpus;
+using caracal::Affinity::parse_cpu_list;
+using caracal::Affinity::ScopedThreadPlacement;
+using caracal::Affinity::set_thread_placement;
+
+TEST_CASE("parse_cpu_list") {
+  REQUIRE(parse_cpu_list("0") == std::vector<int>{0});
+  REQUIRE(parse_cpu_list("0-3,8") == std::vector<int>{0, 1, 2, 3, 8});
+  REQUIRE(parse_cpu_list("2-2,10-11") == std::vector<int>{2, 10, 11});
+  REQUIRE_THROWS_AS(parse_cpu_list(""), std::invalid_argument);
+  REQUIRE_THROWS_AS(parse_cpu_list("a"), std::invalid_argument);
+  REQUIRE_THROWS_AS(parse_cpu_list("-1"), std::invalid_argument);
+  REQUIRE_THROWS_AS(parse_cpu_list("3-1"), std::invalid_argument);
+  REQUIRE_THROWS_AS(parse_cpu_list("1-"), std::invalid_argument);
+  REQUIRE_THROWS_AS(parse_cpu_list("1x"), std::invalid_argument);
+}
+
+TEST_CASE("format_cpu_list") {
+  REQUIRE(format_cpu_list({}).empty());
+  REQUIRE(format_cpu_list({0, 1, 8}) == "0,1,8");
+}
+
+TEST_CASE("numa_node_cpus") {
+  REQUIRE(numa_node_cpus("zzz").empty());
+}
+
+TEST_CASE("set_thread_placement") {
+  REQUIRE_NOTHROW(
+      set_thread_placement(pthread_self(), "test", {}, std::nullopt));
+#ifdef __linux__
+  cpu_set_t before;
+  pthread_getaffinity_np(pthread_self(), sizeof(before), &before);
+  REQUIRE_NOTHROW(
+      set_thread_placement(pthread_self(), "test", {0}, std::nullopt));
+  pthread_setaffinity_np(pthread_self(), sizeof(before), &before);
+  REQUIRE_THROWS_AS(
+      set_thread_placement(pthread_self(), "test", {1 << 20}, std::nullopt),
+      std::invalid_argument);
+#endif
+}
+
+TEST_CASE("ScopedThreadPlacement") {
+#ifdef __linux__
+  cpu_set_t before;
+  pthread_getaffinity_np(pthread_self(), sizeof(before), &before);
+  {
+    ScopedThreadPlacement placement{pthread_self(), "test", {0},
+                                    std::nullopt};
+    cpu_set_t during;
+    pthread_getaffinity_np(pthread_self(), sizeof(during), &during);
+    REQUIRE(CPU_COUNT(&during) == 1);
+    REQUIRE(CPU_ISSET(0, &during));
+  }
+  cpu_set_t after;
+  pthread_getaffinity_np(pthread_self(), sizeof(after), &after);
+  REQUIRE(CPU_EQUAL(&before, &after));
+
+  // The affinity is applied, but the priority is out of range (EINVAL).
+  REQUIRE_THROWS_AS(
+      ScopedThreadPlacement(pthread_self(), "test", {0}, 1000),
+      std::system_error);
+  pthread_getaffinity_np(pthread_self(), sizeof(after), &after);
+  REQUIRE(CPU_EQUAL(&before, &after));
+#endif
+}
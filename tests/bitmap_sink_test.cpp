@@ -0,0 +1,58 @@
+#include <arpa/inet.h>
+
+#include <caracal/bitmap_sink.hpp>
+#include <caracal/reply.hpp>
+#include <caracal/utilities.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using caracal::BitmapSink;
+using caracal::Reply;
+using caracal::Utilities::parse_addr;
+
+namespace {
+
+Reply echo_reply(const std::string& src, const std::string& dst) {
+  Reply reply{};
+  parse_addr(src, reply.reply_src_addr);
+  parse_addr(dst, reply.probe_dst_addr);
+  reply.reply_protocol = IPPROTO_ICMP;
+  reply.reply_icmp_type = 0;
+  return reply;
+}
+
+}  // namespace
+
+TEST_CASE("BitmapSink") {
+  BitmapSink sink;
+  for (const auto& addr : {"0.0.0.0", "10.0.0.1", "10.0.0.2", "10.0.0.3",
+                           "10.0.0.2", "10.0.1.0", "255.255.255.255"}) {
+    sink.write(echo_reply(addr, addr), "1");
+  }
+  // Reply from an intermediate router.
+  sink.write(echo_reply("10.0.0.5", "10.0.0.6"), "1");
+  // Time exceeded from the destination.
+  auto reply = echo_reply("10.0.0.7", "10.0.0.7");
+  reply.reply_icmp_type = 11;
+  sink.write(reply, "1");
+
+  REQUIRE(sink.count() == 6);
+  REQUIRE(sink.contains(0x0A000001));
+  REQUIRE_FALSE(sink.contains(0x0A000005));
+  REQUIRE_FALSE(sink.contains(0x0A000007));
+
+  std::ostringstream os;
+  sink.dump(os);
+  const auto data = os.str();
+  std::vector<uint32_t> runs(data.size() / sizeof(uint32_t));
+  std::memcpy(runs.data(), data.data(), data.size());
+  for (auto& v : runs) {
+    v = ntohl(v);
+  }
+  REQUIRE(runs == std::vector<uint32_t>{0, 0, 0x0A000001, 0x0A000003,
+                                        0x0A000100, 0x0A000100, 0xFFFFFFFF,
+                                        0xFFFFFFFF});
+}
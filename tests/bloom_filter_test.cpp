@@ -0,0 +1,74 @@
+#include <caracal/bloom_filter.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <stdexcept>
+
+using caracal::BloomFilter;
+using caracal::ScalableBloomFilter;
+using caracal::mix64;
+
+TEST_CASE("BloomFilter") {
+  REQUIRE_THROWS_AS(BloomFilter(8), std::domain_error);
+  REQUIRE_THROWS_AS(BloomFilter(20, 0), std::domain_error);
+  REQUIRE_THROWS_AS(BloomFilter(20, 17), std::domain_error);
+
+  BloomFilter filter{20};
+  REQUIRE(filter.size() == 1 << 20);
+
+  for (uint64_t i = 0; i < 10000; i++) {
+    REQUIRE(filter.insert(mix64(i)));
+    REQUIRE_FALSE(filter.insert(mix64(i)));
+    REQUIRE(filter.contains(mix64(i)));
+  }
+
+  // ~100 bits per key, the false positive rate should be negligible.
+  uint64_t false_positives = 0;
+  for (uint64_t i = 10000; i < 20000; i++) {
+    false_positives += filter.contains(mix64(i));
+  }
+  REQUIRE(false_positives < 10);
+
+  filter.clear();
+  REQUIRE_FALSE(filter.contains(mix64(0)));
+}
+
+TEST_CASE("ScalableBloomFilter") {
+  REQUIRE_THROWS_AS(ScalableBloomFilter(0), std::domain_error);
+  REQUIRE_THROWS_AS(ScalableBloomFilter(1), std::domain_error);
+
+  ScalableBloomFilter filter{0.001, 12};
+  REQUIRE(filter.filters() == 1);
+
+  // Insert many more keys than the capacity of the first filter.
+  uint64_t false_positives = 0;
+  for (uint64_t i = 0; i < 100000; i++) {
+    false_positives += !filter.insert(mix64(i));
+  }
+  REQUIRE(filter.filters() > 1);
+  // The target is 100 false positives, allow some slack for blocking.
+  REQUIRE(false_positives < 200);
+
+  for (uint64_t i = 0; i < 100000; i++) {
+    REQUIRE_FALSE(filter.insert(mix64(i)));
+  }
+}
+
+TEST_CASE("ScalableBloomFilter/size") {
+  // The chain must not need many more bits per key than a single filter
+  // sized for the final number of keys (~15 bits per key at 0.1%).
+  ScalableBloomFilter filter{0.001, 12};
+  const uint64_t n = 1000000;
+  uint64_t false_positives = 0;
+  for (uint64_t i = 0; i < n; i++) {
+    false_positives += !filter.insert(mix64(i));
+  }
+  REQUIRE(filter.size() <= 40 * n);
+  // The target is 1000 false positives.
+  REQUIRE(false_positives < 2 * n / 1000);
+
+  // With a larger number of hashes per key.
+  BloomFilter wide{20, 16};
+  for (uint64_t i = 0; i < 10000; i++) {
+    REQUIRE(wide.insert(mix64(i)));
+    REQUIRE(wide.contains(mix64(i)));
+  }
+}
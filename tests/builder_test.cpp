@@ -115,6 +115,17 @@ TEST_CASE("Builder::ICMP") {
     ICMP::init(packet, flow_id, timestamp_enc);
     return packet;
   };
+
+  BENCHMARK("Builder::ICMP/Layout") {
+    Packet packet{buffer.data(), buffer.size(),
+                  caracal::Layout<Protocols::L2::Ethernet, Protocols::L3::IPv4,
+                                  Protocols::L4::ICMP>{},
+                  payload_len};
+    Ethernet::init(packet, {0}, {0});
+    IPv4::init(packet, src_addr, dst_addr, ttl, probe_id);
+    ICMP::init(packet, flow_id, timestamp_enc);
+    return packet;
+  };
 }
 
 TEST_CASE("Builder::ICMPv6") {
@@ -196,6 +207,17 @@ TEST_CASE("Builder::UDP/v4") {
     UDP::init(packet, timestamp_enc, src_port, dst_port);
     return packet;
   };
+
+  BENCHMARK("Builder::UDP/v4/Layout") {
+    Packet packet{buffer.data(), buffer.size(),
+                  caracal::Layout<Protocols::L2::Ethernet, Protocols::L3::IPv4,
+                                  Protocols::L4::UDP>{},
+                  payload_len};
+    Ethernet::init(packet, {0}, {0});
+    IPv4::init(packet, src_addr, dst_addr, ttl, probe_id);
+    UDP::init(packet, timestamp_enc, src_port, dst_port);
+    return packet;
+  };
 }
 
 TEST_CASE("Builder::UDP/v6") {
@@ -234,3 +256,43 @@ TEST_CASE("Builder::UDP/v6") {
   REQUIRE(udp.dport() == dst_port);
   REQUIRE(udp.checksum() == timestamp_enc);
 }
+
+template <Protocols::L2 L2, Protocols::L3 L3, Protocols::L4 L4>
+void check_layout(array<byte, 65536>& buffer) {
+  const Packet expected{buffer.data(), buffer.size(), L2, L3, L4, 10};
+  const Packet packet{buffer.data(), buffer.size(),
+                      caracal::Layout<L2, L3, L4>{}, 10};
+  REQUIRE(packet.l2() == expected.l2());
+  REQUIRE(packet.l3() == expected.l3());
+  REQUIRE(packet.l4() == expected.l4());
+  REQUIRE(packet.payload() == expected.payload());
+  REQUIRE(packet.end() == expected.end());
+  REQUIRE(packet.l2_protocol() == L2);
+  REQUIRE(packet.l3_protocol() == L3);
+  REQUIRE(packet.l4_protocol() == L4);
+}
+
+TEST_CASE("Layout") {
+  using L2 = Protocols::L2;
+  using L3 = Protocols::L3;
+  using L4 = Protocols::L4;
+  static_assert(caracal::Layout<L2::Ethernet, L3::IPv4, L4::UDP>::l3_offset %
+                    4 ==
+                0);
+  static_assert(
+      caracal::Layout<L2::Ethernet, L3::IPv6, L4::ICMPv6>::payload_offset ==
+      2 + 14 + 40 + 8);
+
+  array<byte, 65536> buffer{};
+  check_layout<L2::Ethernet, L3::IPv4, L4::ICMP>(buffer);
+  check_layout<L2::Ethernet, L3::IPv4, L4::UDP>(buffer);
+  check_layout<L2::Ethernet, L3::IPv6, L4::ICMPv6>(buffer);
+  check_layout<L2::Ethernet, L3::IPv6, L4::UDP>(buffer);
+  check_layout<L2::BSDLoopback, L3::IPv4, L4::ICMP>(buffer);
+  check_layout<L2::None, L3::IPv6, L4::UDP>(buffer);
+
+  REQUIRE_THROWS_AS((Packet{buffer.data(), 32,
+                            caracal::Layout<L2::Ethernet, L3::IPv4, L4::ICMP>{},
+                            10}),
+                    std::invalid_argument);
+}
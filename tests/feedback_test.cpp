@@ -0,0 +1,106 @@
+#include <caracal/feedback.hpp>
+#include <caracal/probe.hpp>
+#include <caracal/reply.hpp>
+#include <caracal/utilities.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+
+using caracal::DestinationTable;
+using caracal::Feedback;
+using caracal::Probe;
+using caracal::Reply;
+using caracal::Utilities::parse_addr;
+
+namespace {
+
+in6_addr addr(const std::string& s) {
+  in6_addr a{};
+  parse_addr(s, a);
+  return a;
+}
+
+Reply time_exceeded(const std::string& src, const std::string& dst,
+                    uint8_t ttl) {
+  Reply reply{};
+  reply.reply_src_addr = addr(src);
+  reply.probe_dst_addr = addr(dst);
+  reply.probe_ttl = ttl;
+  reply.reply_protocol = IPPROTO_ICMP;
+  reply.reply_icmp_type = 11;
+  return reply;
+}
+
+Probe probe(const std::string& dst, uint8_t ttl) {
+  Probe p{};
+  p.dst_addr = addr(dst);
+  p.ttl = ttl;
+  return p;
+}
+
+}  // namespace
+
+TEST_CASE("DestinationTable") {
+  DestinationTable table{10};
+  REQUIRE(table.stop_ttl(addr("8.8.8.8")) == 0);
+  table.raise_stop_ttl(addr("8.8.8.8"), 5);
+  table.raise_stop_ttl(addr("8.8.8.8"), 3);
+  REQUIRE(table.stop_ttl(addr("8.8.8.8")) == 5);
+  REQUIRE(table.stop_ttl(addr("8.8.4.4")) == 0);
+
+  REQUIRE(table.reached_ttl(addr("8.8.8.8")) == 0);
+  table.lower_reached_ttl(addr("8.8.8.8"), 12);
+  table.lower_reached_ttl(addr("8.8.8.8"), 14);
+  REQUIRE(table.reached_ttl(addr("8.8.8.8")) == 12);
+  REQUIRE(table.stop_ttl(addr("8.8.8.8")) == 5);
+}
+
+TEST_CASE("Feedback") {
+  Feedback feedback{16, 10};
+
+  // First destination of the prefix: nothing is stopped, even on repeated
+  // replies.
+  feedback.observe(time_exceeded("10.0.0.1", "192.0.2.1", 6));
+  feedback.observe(time_exceeded("10.0.0.1", "192.0.2.1", 6));
+  REQUIRE_FALSE(feedback.stopped(probe("192.0.2.1", 5)));
+
+  // Another destination of the same prefix reaches the same interface:
+  // the lower TTLs are stopped.
+  feedback.observe(time_exceeded("10.0.0.1", "192.0.2.2", 7));
+  REQUIRE(feedback.stopped(probe("192.0.2.2", 6)));
+  REQUIRE_FALSE(feedback.stopped(probe("192.0.2.2", 7)));
+  REQUIRE_FALSE(feedback.stopped(probe("192.0.2.1", 5)));
+
+  // Same interface, other prefix.
+  feedback.observe(time_exceeded("10.0.0.1", "198.51.100.1", 7));
+  REQUIRE_FALSE(feedback.stopped(probe("198.51.100.1", 6)));
+
+  // Destination unreachable messages are ignored.
+  auto reply = time_exceeded("10.0.0.2", "192.0.2.3", 7);
+  reply.reply_icmp_type = 3;
+  feedback.observe(reply);
+  feedback.observe(time_exceeded("10.0.0.2", "192.0.2.4", 8));
+  REQUIRE_FALSE(feedback.stopped(probe("192.0.2.4", 7)));
+}
+
+TEST_CASE("Feedback/Reached") {
+  Feedback feedback{16, 10};
+
+  auto reply = time_exceeded("8.8.8.8", "8.8.8.8", 12);
+  reply.reply_icmp_type = 0;
+  feedback.observe(reply);
+  REQUIRE_FALSE(feedback.reached(probe("8.8.8.8", 12)));
+  REQUIRE(feedback.reached(probe("8.8.8.8", 13)));
+  REQUIRE_FALSE(feedback.reached(probe("8.8.4.4", 13)));
+
+  // Destination unreachable from the destination itself.
+  reply = time_exceeded("8.8.4.4", "8.8.4.4", 10);
+  reply.reply_icmp_type = 3;
+  feedback.observe(reply);
+  REQUIRE(feedback.reached(probe("8.8.4.4", 11)));
+
+  // Destination unreachable from an intermediate router.
+  reply = time_exceeded("10.0.0.1", "1.1.1.1", 5);
+  reply.reply_icmp_type = 3;
+  feedback.observe(reply);
+  REQUIRE_FALSE(feedback.reached(probe("1.1.1.1", 6)));
+}
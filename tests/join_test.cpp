@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <caracal/join.hpp>
+#include <caracal/probe.hpp>
+#include <caracal/probe_log.hpp>
+#include <caracal/reply.hpp>
+#include <caracal/reply_sink.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using caracal::BinarySink;
+using caracal::Probe;
+using caracal::ProbeLog;
+using caracal::Reply;
+using caracal::Join::Destination;
+using caracal::Join::Entry;
+using caracal::Join::ExternalSorter;
+using caracal::Join::Options;
+using caracal::Join::ProbeResult;
+using std::chrono::microseconds;
+using std::chrono::nanoseconds;
+
+namespace {
+
+void write_probes(const fs::path &path,
+                  const std::vector<ProbeLog::Record> &records) {
+  std::ofstream ofs{path, std::ios::binary};
+  std::byte buffer[ProbeLog::Record::binary_size];
+  for (const auto &record : records) {
+    record.to_binary(buffer);
+    ofs.write(reinterpret_cast<const char *>(buffer), sizeof(buffer));
+  }
+}
+
+Reply make_reply(const Probe &probe, const int64_t capture_timestamp) {
+  Reply reply{};
+  reply.capture_timestamp = capture_timestamp;
+  reply.probe_dst_addr = probe.dst_addr;
+  reply.probe_protocol = caracal::Protocols::posix_value(probe.protocol);
+  reply.probe_src_port = probe.src_port;
+  reply.probe_dst_port = probe.dst_port;
+  reply.probe_ttl = probe.ttl;
+  return reply;
+}
+
+}  // namespace
+
+TEST_CASE("Join::ExternalSorter") {
+  std::mt19937_64 gen{42};
+  std::vector<Entry> entries(1000);
+  for (auto &entry : entries) {
+    entry = Entry{};
+    entry.dst_addr.s6_addr32[3] = static_cast<uint32_t>(gen() % 100);
+    entry.ttl = static_cast<uint8_t>(gen() % 32);
+    entry.timestamp = nanoseconds{static_cast<int64_t>(gen() % 1000)};
+  }
+  auto expected = entries;
+  std::sort(expected.begin(), expected.end());
+
+  for (const size_t run_size : {1, 7, 1000, 5000}) {
+    ExternalSorter sorter{fs::current_path(), run_size};
+    for (const auto &entry : entries) {
+      sorter.push(entry);
+    }
+    sorter.finish();
+    // The entries stay in memory if they fit in a single run.
+    const auto runs = run_size > entries.size()
+                          ? 0
+                          : (entries.size() + run_size - 1) / run_size;
+    REQUIRE(sorter.runs() == runs);
+    Entry entry{};
+    size_t i = 0;
+    while (sorter.next(entry)) {
+      REQUIRE(i < expected.size());
+      REQUIRE(!(entry < expected[i]));
+      REQUIRE(!(expected[i] < entry));
+      i++;
+    }
+    REQUIRE(i == expected.size());
+  }
+}
+
+TEST_CASE("Join::join") {
+  const fs::path probes_path = "zzz_probes.bin";
+  const fs::path replies_path = "zzz_replies.bin";
+
+  // Two destinations, the second one is answered once out of three probes,
+  // and its third probe is the same as the first one, sent again later.
+  auto a = Probe::from_csv("192.0.2.1,24000,33434,5,udp,0");
+  auto b = Probe::from_csv("192.0.2.2,24000,0,3,icmp,0");
+  auto b2 = b;
+  b2.ttl = 4;
+  std::vector<ProbeLog::Record> records{
+      {0, nanoseconds{1'000'000'000}, a},
+      {1, nanoseconds{1'000'100'000}, b},
+      {2, nanoseconds{1'000'200'000}, b2},
+      {3, nanoseconds{2'000'000'000}, b},
+  };
+  write_probes(probes_path, records);
+
+  {
+    std::ofstream ofs{replies_path, std::ios::binary};
+    BinarySink sink{ofs};
+    // Two replies to `a` (a duplicate), one to the last `b`, and one unknown.
+    sink.write(make_reply(a, 1'000'250), "1");
+    sink.write(make_reply(a, 1'000'300), "1");
+    sink.write(make_reply(b, 2'000'010), "1");
+    auto c = a;
+    c.ttl = 6;
+    sink.write(make_reply(c, 1'000'500), "1");
+  }
+
+  for (const size_t run_size : {1, 1000}) {
+    Options options;
+    options.temp_directory = fs::current_path();
+    options.run_size = run_size;
+    std::vector<Destination> destinations;
+    std::vector<ProbeResult> results;
+    const auto summary = caracal::Join::join(
+        {probes_path}, {replies_path}, options,
+        [&](const Destination &d) { destinations.push_back(d); },
+        [&](const ProbeResult &r) { results.push_back(r); });
+
+    REQUIRE(summary.probes == 4);
+    REQUIRE(summary.answered == 2);
+    REQUIRE(summary.replies == 3);
+    REQUIRE(summary.unmatched_replies == 1);
+
+    REQUIRE(results.size() == 4);
+    REQUIRE(results[0].probe.sequence == 0);
+    REQUIRE(results[0].replies == 2);
+    REQUIRE(results[0].rtt == microseconds{250});
+    REQUIRE(results[1].probe.sequence == 1);
+    REQUIRE(!results[1].rtt);
+    REQUIRE(results[2].probe.sequence == 3);
+    REQUIRE(results[2].rtt == microseconds{10});
+    REQUIRE(results[3].probe.sequence == 2);
+    REQUIRE(!results[3].rtt);
+
+    REQUIRE(destinations.size() == 2);
+    REQUIRE(destinations[0].to_csv() ==
+            "::ffff:192.0.2.1,1,1,2,0.000,250,250,250");
+    REQUIRE(destinations[1].to_csv() ==
+            "::ffff:192.0.2.2,3,1,1,0.667,10,10,10");
+    REQUIRE(results[2].to_csv() ==
+            "3,2000000000,1,::ffff:192.0.2.2,24000,0,3,1,10");
+  }
+
+  fs::remove(probes_path);
+  fs::remove(replies_path);
+}
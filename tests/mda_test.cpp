@@ -0,0 +1,75 @@
+#include <caracal/mda.hpp>
+#include <caracal/protocols.hpp>
+#include <caracal/reply.hpp>
+#include <caracal/utilities.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <memory>
+#include <string>
+
+using caracal::Reply;
+using caracal::MDA::Engine;
+using caracal::MDA::stopping_point;
+using caracal::Protocols::L4;
+using caracal::Utilities::parse_addr;
+
+TEST_CASE("MDA::stopping_point") {
+  // See Table 1 in Veitch et al., 2009.
+  REQUIRE(stopping_point(0, 0.05) == 6);
+  REQUIRE(stopping_point(1, 0.05) == 6);
+  REQUIRE(stopping_point(2, 0.05) == 11);
+  REQUIRE(stopping_point(3, 0.05) == 16);
+  REQUIRE(stopping_point(4, 0.05) == 21);
+  REQUIRE(stopping_point(5, 0.05) == 27);
+}
+
+TEST_CASE("MDA::Engine") {
+  in6_addr destination{};
+  in6_addr interface1{};
+  in6_addr interface2{};
+  in6_addr interface3{};
+  parse_addr("8.8.8.8", destination);
+  parse_addr("10.0.0.1", interface1);
+  parse_addr("10.0.0.2", interface2);
+  parse_addr("10.0.0.3", interface3);
+
+  auto engine = Engine{{destination, destination}, 1, 4, L4::ICMP};
+
+  auto reply = [&](const in6_addr& src, uint8_t ttl, uint8_t icmp_type) {
+    Reply r{};
+    r.reply_src_addr = src;
+    r.probe_dst_addr = destination;
+    r.probe_ttl = ttl;
+    r.reply_protocol = IPPROTO_ICMP;
+    r.reply_icmp_type = icmp_type;
+    engine.write(r, "1");
+  };
+
+  // Round 1: 6 flows per TTL.
+  auto probes = engine.next_round();
+  REQUIRE(probes.size() == 4 * 6);
+  REQUIRE(probes.front().src_port == Engine::src_port);
+  REQUIRE(probes.back().src_port == Engine::src_port + 5);
+  REQUIRE(engine.flows(destination, 1) == 6);
+
+  // TTL 1: one interface, TTL 2: two interfaces, TTL 3: destination.
+  reply(interface1, 1, 11);
+  reply(interface1, 1, 11);
+  reply(interface2, 2, 11);
+  reply(interface3, 2, 11);
+  reply(destination, 3, 0);
+  REQUIRE(engine.interfaces(destination, 1).size() == 1);
+  REQUIRE(engine.interfaces(destination, 2).size() == 2);
+
+  // Round 2: 11 - 6 flows at TTL 2, none beyond the destination.
+  probes = engine.next_round();
+  REQUIRE(probes.size() == 5);
+  for (const auto& probe : probes) {
+    REQUIRE(probe.ttl == 2);
+  }
+  REQUIRE(probes.front().src_port == Engine::src_port + 6);
+  REQUIRE(engine.flows(destination, 2) == 11);
+  REQUIRE(engine.flows(destination, 4) == 6);
+
+  // Round 3: converged.
+  REQUIRE(engine.next_round().empty());
+}
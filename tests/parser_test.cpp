@@ -1,15 +1,22 @@
 #include <tins/tins.h>
 
+#include <caracal/builder.hpp>
+#include <caracal/constants.hpp>
+#include <caracal/packet.hpp>
 #include <caracal/parser.hpp>
+#include <caracal/probe.hpp>
 #include <caracal/utilities.hpp>
 #include <catch2/catch_test_macros.hpp>
+#include <array>
 #include <filesystem>
 #include <string>
 #include <vector>
 
 using caracal::Parser::build_inner;
 using caracal::Parser::parse;
+using caracal::Parser::parse_probe;
 using caracal::Utilities::format_addr;
+using caracal::Utilities::parse_addr;
 
 namespace fs = std::filesystem;
 
@@ -252,3 +259,58 @@ TEST_CASE("Parser::parse/Invalid") {
     REQUIRE(!parse(Tins::Packet{}));
   }
 }
+
+// Probes looped back by the kernel (see Sender::read_tx_timestamps).
+TEST_CASE("Parser::parse_probe") {
+  namespace Builder = caracal::Builder;
+  namespace Protocols = caracal::Protocols;
+  std::array<std::byte, 65536> buffer{};
+  in6_addr src_v6{};
+  parse_addr("2001:db8::1", src_v6);
+
+  // Build the probe as the sender does.
+  auto build = [&](const caracal::Probe& probe) {
+    caracal::Packet packet{buffer.data(),
+                           buffer.size(),
+                           Protocols::L2::None,
+                           probe.l3_protocol(),
+                           probe.l4_protocol(),
+                           static_cast<size_t>(probe.ttl + PAYLOAD_TWEAK_BYTES)};
+    if (probe.l3_protocol() == Protocols::L3::IPv4) {
+      Builder::IPv4::init(packet, in_addr{16909060},
+                          probe.sockaddr4().sin_addr, probe.ttl, 1234);
+    } else {
+      Builder::IPv6::init(packet, src_v6, probe.sockaddr6().sin6_addr,
+                          probe.ttl, probe.flow_label);
+    }
+    switch (probe.l4_protocol()) {
+      case Protocols::L4::ICMP:
+        Builder::ICMP::init(packet, probe.src_port, 42);
+        break;
+      case Protocols::L4::ICMPv6:
+        Builder::ICMPv6::init(packet, probe.src_port, 42);
+        break;
+      case Protocols::L4::UDP:
+        Builder::UDP::init(packet, 42, probe.src_port, probe.dst_port);
+        break;
+    }
+    return packet;
+  };
+
+  for (const auto& line :
+       {"8.8.8.8,24000,0,6,icmp", "8.8.8.8,24000,33434,6,udp",
+        "2001:4860:4860::8888,24001,0,12,icmp6",
+        "2001:4860:4860::8888,24001,33435,12,udp"}) {
+    auto probe = caracal::Probe::from_csv(line);
+    if (probe.l3_protocol() == Protocols::L3::IPv6) {
+      probe.flow_label = 12345;
+    }
+    const auto packet = build(probe);
+    const auto parsed = parse_probe(packet.l3(), packet.l3_size());
+    REQUIRE(parsed);
+    REQUIRE(*parsed == probe);
+    REQUIRE(!parse_probe(packet.l3(), 20));
+  }
+
+  REQUIRE(!parse_probe(buffer.data(), 0));
+}
@@ -0,0 +1,132 @@
+#include <caracal/pcap_writer.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using caracal::PcapWriter;
+
+namespace {
+
+/// Read the (uncompressed) records of a pcap file.
+std::vector<std::vector<u_char>> read_pcap(const fs::path &path,
+                                           uint32_t &link_type) {
+  std::ifstream ifs{path, std::ios::binary};
+  std::vector<char> data{std::istreambuf_iterator<char>{ifs}, {}};
+  REQUIRE(data.size() >= 24);
+  uint32_t magic = 0;
+  std::memcpy(&magic, data.data(), 4);
+  REQUIRE(magic == 0xa1b2c3d4);
+  std::memcpy(&link_type, data.data() + 20, 4);
+  std::vector<std::vector<u_char>> frames;
+  size_t offset = 24;
+  while (offset < data.size()) {
+    uint32_t header[4];
+    std::memcpy(header, data.data() + offset, 16);
+    REQUIRE(header[2] <= header[3]);
+    offset += 16;
+    frames.emplace_back(data.data() + offset,
+                        data.data() + offset + header[2]);
+    offset += header[2];
+  }
+  REQUIRE(offset == data.size());
+  return frames;
+}
+
+pcap_pkthdr make_header(const uint32_t n, const uint32_t size) {
+  pcap_pkthdr header{};
+  header.ts.tv_sec = 1613155623 + n;
+  header.caplen = size;
+  header.len = size;
+  return header;
+}
+
+}  // namespace
+
+TEST_CASE("PcapWriter") {
+  const fs::path prefix = "zzz_capture";
+  std::vector<fs::path> files;
+  std::vector<u_char> frame(100);
+
+  SECTION("Single file") {
+    {
+      PcapWriter writer{prefix, 1, {}};
+      for (uint32_t n = 0; n < 1000; n++) {
+        frame[0] = static_cast<u_char>(n);
+        REQUIRE(writer.write(make_header(n, 100), frame.data()));
+      }
+      // Wait for the writer thread, the file is created on the first frame.
+      while (writer.written() < 1000) {
+      }
+      files = writer.files();
+    }
+    REQUIRE(files.size() == 1);
+    REQUIRE(files[0] == PcapWriter::file_path(prefix, 0, false));
+    uint32_t link_type = 0;
+    auto frames = read_pcap(files[0], link_type);
+    REQUIRE(link_type == 1);
+    REQUIRE(frames.size() == 1000);
+    for (uint32_t n = 0; n < 1000; n++) {
+      REQUIRE(frames[n].size() == 100);
+      REQUIRE(frames[n][0] == static_cast<u_char>(n));
+    }
+  }
+
+  SECTION("Rotation and truncation") {
+    PcapWriter::Options options;
+    options.rotate_size = 10'000;
+    options.snaplen = 64;
+    {
+      PcapWriter writer{prefix, 1, options};
+      for (uint32_t n = 0; n < 1000; n++) {
+        frame[0] = static_cast<u_char>(n);
+        // Stay below the buffer capacity.
+        while (!writer.write(make_header(n, 100), frame.data())) {
+        }
+      }
+    }
+    // (16 + 64) bytes per record: 125 records per file of 10 KB.
+    files.clear();
+    for (uint64_t n = 0; fs::exists(PcapWriter::file_path(prefix, n, false));
+         n++) {
+      files.push_back(PcapWriter::file_path(prefix, n, false));
+    }
+    REQUIRE(files.size() == 8);
+    uint32_t count = 0;
+    for (const auto &file : files) {
+      uint32_t link_type = 0;
+      for (const auto &f : read_pcap(file, link_type)) {
+        REQUIRE(f.size() == 64);
+        REQUIRE(f[0] == static_cast<u_char>(count));
+        count++;
+      }
+    }
+    REQUIRE(count == 1000);
+  }
+
+  SECTION("Full buffer") {
+    PcapWriter::Options options;
+    options.buffer_size = 1024;
+    options.snaplen = 1000;
+    {
+      PcapWriter writer{prefix, 1, options};
+      std::vector<u_char> large(1000);
+      uint64_t accepted = 0;
+      for (uint32_t n = 0; n < 100; n++) {
+        accepted += writer.write(make_header(n, 1000), large.data()) ? 1 : 0;
+      }
+      REQUIRE(accepted + writer.dropped() == 100);
+      REQUIRE(accepted >= 1);
+    }
+  }
+
+  for (uint64_t n = 0; fs::exists(PcapWriter::file_path(prefix, n, false));
+       n++) {
+    fs::remove(PcapWriter::file_path(prefix, n, false));
+  }
+}
@@ -0,0 +1,39 @@
+#include <caracal/permutation.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <stdexcept>
+#include <vector>
+
+using caracal::Permutation;
+
+TEST_CASE("Permutation") {
+  REQUIRE_THROWS_AS(Permutation(0, 42), std::domain_error);
+
+  auto size = GENERATE(as<uint64_t>{}, 1, 2, 3, 7, 16, 1000, 65537);
+  Permutation permutation{size, 42};
+  REQUIRE(permutation.size() == size);
+
+  std::vector<bool> seen(size, false);
+  uint64_t fixed_points = 0;
+  for (uint64_t i = 0; i < size; i++) {
+    const auto j = permutation(i);
+    REQUIRE(j < size);
+    REQUIRE_FALSE(seen[j]);
+    seen[j] = true;
+    fixed_points += (i == j);
+  }
+  if (size >= 1000) {
+    REQUIRE(fixed_points < size / 100);
+  }
+
+  // Same key, same permutation; other key, other permutation.
+  REQUIRE(Permutation(size, 42)(size - 1) == permutation(size - 1));
+  if (size >= 1000) {
+    uint64_t same = 0;
+    Permutation other{size, 43};
+    for (uint64_t i = 0; i < size; i++) {
+      same += (other(i) == permutation(i));
+    }
+    REQUIRE(same < size / 100);
+  }
+}
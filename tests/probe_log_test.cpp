@@ -0,0 +1,94 @@
+#include <caracal/probe.hpp>
+#include <caracal/probe_log.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using caracal::Probe;
+using caracal::ProbeLog;
+using std::chrono::nanoseconds;
+
+namespace {
+
+std::vector<ProbeLog::Record> read_records(const fs::path &path) {
+  std::ifstream ifs{path, std::ios::binary};
+  std::vector<char> data{std::istreambuf_iterator<char>{ifs}, {}};
+  REQUIRE(data.size() % ProbeLog::Record::binary_size == 0);
+  std::vector<ProbeLog::Record> records;
+  for (size_t offset = 0; offset < data.size();
+       offset += ProbeLog::Record::binary_size) {
+    records.push_back(ProbeLog::Record::from_binary(
+        reinterpret_cast<const std::byte *>(data.data() + offset)));
+  }
+  return records;
+}
+
+}  // namespace
+
+TEST_CASE("ProbeLog") {
+  const fs::path path = "zzz_probes.bin";
+  fs::remove(path);
+  auto probe = Probe::from_csv("::ffff:192.0.2.1,24000,33434,32,udp,0");
+
+  SECTION("Append") {
+    {
+      ProbeLog log{path};
+      for (uint8_t ttl = 1; ttl <= 100; ttl++) {
+        probe.ttl = ttl;
+        REQUIRE(log.write(probe, nanoseconds{1'613'155'623'845'580'123 + ttl}));
+      }
+    }
+    // A partial record, e.g. from a killed run.
+    std::ofstream{path, std::ios::binary | std::ios::app} << "abc";
+    {
+      ProbeLog log{path};
+      probe.ttl = 101;
+      REQUIRE(log.write(probe, nanoseconds{1}));
+      while (log.written() < 1) {
+      }
+    }
+    const auto records = read_records(path);
+    REQUIRE(records.size() == 101);
+    for (uint64_t i = 0; i < 101; i++) {
+      REQUIRE(records[i].sequence == i);
+      REQUIRE(records[i].probe.ttl == i + 1);
+    }
+    REQUIRE(records[100].probe == probe);
+    REQUIRE(records[99].timestamp.count() == 1'613'155'623'845'580'223);
+    REQUIRE(records[100].timestamp.count() == 1);
+  }
+
+  SECTION("Full buffer") {
+    {
+      ProbeLog log{path, 4};
+      uint64_t accepted = 0;
+      for (int i = 0; i < 100; i++) {
+        accepted += log.write(probe, nanoseconds{i}) ? 1 : 0;
+      }
+      REQUIRE(accepted + log.dropped() == 100);
+      REQUIRE(accepted >= 4);
+    }
+    // The dropped records leave gaps in the sequence numbers.
+    const auto records = read_records(path);
+    for (size_t i = 1; i < records.size(); i++) {
+      REQUIRE(records[i].sequence > records[i - 1].sequence);
+      REQUIRE(records[i].timestamp.count() ==
+              static_cast<int64_t>(records[i].sequence));
+    }
+  }
+
+  SECTION("Benchmark") {
+    ProbeLog log{path};
+    int64_t i = 0;
+    BENCHMARK("ProbeLog::write") { return log.write(probe, nanoseconds{i++}); };
+  }
+
+  fs::remove(path);
+}
@@ -3,6 +3,7 @@
 #include <caracal/utilities.hpp>
 #include <catch2/benchmark/catch_benchmark.hpp>
 #include <catch2/catch_test_macros.hpp>
+#include <array>
 #include <sstream>
 
 using caracal::Probe;
@@ -115,3 +116,16 @@ TEST_CASE("Probe::from_csv") {
     REQUIRE_THROWS(Probe::from_csv("8.8.8.8,1,2,3,icmp,-1"));
   }
 }
+
+TEST_CASE("Probe::from_binary") {
+  Probe probe = Probe::from_csv("2001:4860:4860::8888,24000,33434,12,udp,7,42");
+  std::array<std::byte, Probe::binary_size> buffer{};
+  probe.to_binary(buffer.data());
+  Probe decoded = Probe::from_binary(buffer.data());
+  REQUIRE(decoded == probe);
+  REQUIRE(decoded.wait_us == 42);
+
+  // Invalid protocol
+  buffer[21] = std::byte{6};
+  REQUIRE_THROWS(Probe::from_binary(buffer.data()));
+}
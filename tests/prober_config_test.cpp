@@ -50,4 +50,66 @@ TEST_CASE("Prober::Config") {
   REQUIRE_THROWS_AS(config.set_filter_max_ttl(-1), std::domain_error);
 
   REQUIRE_NOTHROW(config.set_meta_round("zzz"));
+
+  REQUIRE_NOTHROW(config.set_output_format("binary"));
+  REQUIRE_THROWS_AS(config.set_output_format("zzz"), std::invalid_argument);
+
+  REQUIRE_NOTHROW(config.set_output_shm("/caracal"));
+  REQUIRE_THROWS_AS(config.set_output_shm("caracal"), std::invalid_argument);
+  REQUIRE_THROWS_AS(config.set_output_shm("/a/b"), std::invalid_argument);
+
+  REQUIRE_NOTHROW(config.set_output_shm_capacity(1024));
+  REQUIRE_THROWS_AS(config.set_output_shm_capacity(0), std::domain_error);
+  REQUIRE_THROWS_AS(config.set_output_shm_capacity(1000), std::domain_error);
+
+  REQUIRE_NOTHROW(config.set_output_pcap("capture"));
+  REQUIRE_THROWS_AS(config.set_output_pcap("zzz/capture"),
+                    std::invalid_argument);
+  REQUIRE_THROWS_AS(config.set_output_pcap("/tmp/"), std::invalid_argument);
+  REQUIRE_NOTHROW(config.set_output_pcap_rotate_size(100));
+  REQUIRE_THROWS_AS(config.set_output_pcap_rotate_size(0), std::domain_error);
+  REQUIRE_NOTHROW(config.set_output_pcap_rotate_interval(60));
+  REQUIRE_THROWS_AS(config.set_output_pcap_rotate_interval(-1),
+                    std::domain_error);
+  REQUIRE_NOTHROW(config.set_output_pcap_zstd(true));
+
+  REQUIRE_NOTHROW(config.set_drain_rtt_factor(3));
+  REQUIRE_THROWS_AS(config.set_drain_rtt_factor(0), std::domain_error);
+
+  REQUIRE_NOTHROW(config.set_stop_set(true));
+  REQUIRE_NOTHROW(config.set_prune_reached(true));
+
+  REQUIRE_NOTHROW(config.set_dedup_fp_rate(0.001));
+  REQUIRE_THROWS_AS(config.set_dedup_fp_rate(0), std::domain_error);
+  REQUIRE_THROWS_AS(config.set_dedup_fp_rate(1), std::domain_error);
+
+  REQUIRE_NOTHROW(config.add_source("eth0"));
+  REQUIRE_NOTHROW(config.add_source("eth1,192.0.2.1,2001:db8::1"));
+  REQUIRE_NOTHROW(config.add_source("eth2,2001:db8::2"));
+  REQUIRE(config.sources.size() == 3);
+  REQUIRE(config.sources[1].interface == "eth1");
+  REQUIRE(config.sources[1].source_ipv4->to_string() == "192.0.2.1");
+  REQUIRE(config.sources[2].source_ipv6->to_string() == "2001:db8::2");
+  REQUIRE_FALSE(config.sources[2].source_ipv4);
+  REQUIRE_THROWS_AS(config.add_source(""), std::invalid_argument);
+  REQUIRE_THROWS_AS(config.add_source(",192.0.2.1"), std::invalid_argument);
+  REQUIRE_THROWS_AS(config.add_source("eth0,zzz"), std::invalid_argument);
+  REQUIRE_THROWS_AS(config.add_source("eth0,192.0.2.1,192.0.2.2"),
+                    std::invalid_argument);
+
+  REQUIRE_NOTHROW(config.set_sender_cpus("0-1"));
+  REQUIRE(config.sender_cpus == std::vector<int>{0, 1});
+  REQUIRE_NOTHROW(config.set_sniffer_cpus("2"));
+  REQUIRE_NOTHROW(config.set_stats_cpus("3"));
+  REQUIRE_THROWS_AS(config.set_sniffer_cpus("zzz"), std::invalid_argument);
+  REQUIRE_NOTHROW(config.set_numa_local(true));
+  REQUIRE_NOTHROW(config.set_realtime_priority(50));
+  REQUIRE_THROWS_AS(config.set_realtime_priority(0), std::domain_error);
+  REQUIRE_THROWS_AS(config.set_realtime_priority(100), std::domain_error);
+
+  REQUIRE_NOTHROW(config.set_busy_poll(50));
+  REQUIRE_THROWS_AS(config.set_busy_poll(0), std::domain_error);
+  REQUIRE_NOTHROW(config.set_qdisc_bypass(true));
+  REQUIRE_NOTHROW(config.set_strict_filter(true));
+  REQUIRE_NOTHROW(config.set_tx_timestamps(true));
 }
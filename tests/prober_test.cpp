@@ -1,14 +1,28 @@
 #include <spdlog/cfg/helpers.h>
 #include <spdlog/spdlog.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
+#include <array>
+#include <caracal/probe_log.hpp>
 #include <caracal/prober.hpp>
 #include <caracal/prober_config.hpp>
+#include <caracal/prober_session.hpp>
+#include <caracal/reply_sink.hpp>
 #include <caracal/utilities.hpp>
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/generators/catch_generators.hpp>
+#include <chrono>
 #include <cstdlib>
 #include <filesystem>
 #include <iostream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "./environment.hpp"
 
@@ -241,3 +255,254 @@ TEST_CASE("Prober::probe/v6") {
   fs::remove("zzz_output.csv");
   fs::remove("zzz_output.pcap");
 }
+
+TEST_CASE("Prober::random_iterator") {
+  using caracal::Probe;
+  using caracal::Protocols::L4;
+
+  in6_addr v4{};
+  in6_addr v6{};
+  caracal::Utilities::parse_addr("8.8.8.8", v4);
+  caracal::Utilities::parse_addr("2001:4860:4860::8888", v6);
+
+  auto it = caracal::Prober::random_iterator({v4, v6}, 1, 32, L4::ICMP, 42);
+  std::vector<Probe> probes;
+  Probe p{};
+  while (it(p)) {
+    probes.push_back(p);
+  }
+  REQUIRE(probes.size() == 64);
+
+  // Each (destination, TTL) pair appears once, in a random order.
+  std::set<std::pair<bool, uint8_t>> pairs;
+  uint64_t increasing = 0;
+  for (size_t i = 0; i < probes.size(); i++) {
+    const auto is_v4 = IN6_IS_ADDR_V4MAPPED(&probes[i].dst_addr);
+    REQUIRE(probes[i].protocol == (is_v4 ? L4::ICMP : L4::ICMPv6));
+    pairs.insert({is_v4, probes[i].ttl});
+    if (i > 0 && probes[i].ttl == probes[i - 1].ttl + 1) {
+      increasing++;
+    }
+  }
+  REQUIRE(pairs.size() == 64);
+  REQUIRE(increasing < 16);
+}
+
+TEST_CASE("Prober::sweep_iterator") {
+  using caracal::Probe;
+  using caracal::Protocols::L4;
+
+  auto it = caracal::Prober::sweep_iterator(
+      {"192.0.2.0/24", "198.51.100.7", "203.0.113.9/30"}, L4::ICMP, 42);
+  std::set<uint32_t> addresses;
+  Probe p{};
+  while (it(p)) {
+    REQUIRE(IN6_IS_ADDR_V4MAPPED(&p.dst_addr));
+    REQUIRE(p.ttl == 255);
+    addresses.insert(ntohl(p.dst_addr.s6_addr32[3]));
+  }
+  REQUIRE(addresses.size() == 256 + 1 + 4);
+  REQUIRE(*addresses.begin() == 0xC0000200);
+  REQUIRE(addresses.contains(0xC6336407));
+  REQUIRE(*addresses.rbegin() == 0xCB00710B);
+
+  REQUIRE_THROWS_AS(caracal::Prober::sweep_iterator({"zzz"}, L4::ICMP, 42),
+                    std::invalid_argument);
+}
+
+TEST_CASE("Prober::Session") {
+  std::ofstream ofs;
+  ofs.open("zzz_input.csv");
+  ofs << "8.8.8.8,24000,33434,2,icmp\n";
+  ofs << "8.8.8.8,24000,33434,3,icmp\n";
+  ofs << "8.8.8.8,24000,33434,2,icmp\n";  // Duplicate
+  ofs.close();
+
+  Config config;
+  config.set_batch_size(1);
+  config.set_probing_rate(10);
+  config.set_sniffer_wait_time(1);
+  config.set_dedup_fp_rate(0.001);
+
+  std::ostringstream output;
+  caracal::Prober::Session session{
+      config, std::make_shared<caracal::CsvSink>(output)};
+
+  // The same session is reused across rounds.
+  for (auto round : {"1", "2"}) {
+    auto is = std::ifstream{"zzz_input.csv"};
+    auto [prober_stats, sniffer_stats, pcap_stats] = session.run(is, round);
+    // The duplicates are filtered within a round, not across rounds.
+    REQUIRE(prober_stats.read == 3);
+    REQUIRE(prober_stats.sent == 2);
+    REQUIRE(prober_stats.filtered_duplicate == 1);
+    REQUIRE(sniffer_stats.received_invalid_count == 0);
+  }
+
+  fs::remove("zzz_input.csv");
+}
+
+TEST_CASE("Prober::serve_connection") {
+  using caracal::Probe;
+  using caracal::Reply;
+  using caracal::ReplySink;
+  using caracal::Prober::Iterator;
+
+  // Echo `replies_per_probe` replies for each probe, from another thread (as
+  // the sniffer) and once all the probes have been read.
+  uint64_t replies_per_probe = 1;
+  const auto run = [&](Iterator& it, const std::string& round,
+                       std::shared_ptr<ReplySink> sink) {
+    std::vector<Probe> probes;
+    Probe p{};
+    while (it(p)) {
+      probes.push_back(p);
+    }
+    std::thread sniffer{[&] {
+      for (const auto& probe : probes) {
+        Reply reply{};
+        reply.probe_dst_addr = probe.dst_addr;
+        reply.probe_ttl = probe.ttl;
+        for (uint64_t i = 0; i < replies_per_probe; i++) {
+          sink->write(reply, round);
+        }
+      }
+    }};
+    sniffer.join();
+  };
+
+  // Send `request` and return the lines received until the server closes
+  // the connection.
+  const auto exchange = [&](const std::string& request, bool shutdown_write) {
+    int fds[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    std::thread server{[&] {
+      caracal::Prober::serve_connection(fds[1], run);
+      close(fds[1]);
+    }};
+    REQUIRE(write(fds[0], request.data(), request.size()) ==
+            static_cast<ssize_t>(request.size()));
+    if (shutdown_write) {
+      shutdown(fds[0], SHUT_WR);
+    }
+    std::string response;
+    std::array<char, 4096> buffer{};
+    ssize_t n;
+    while ((n = read(fds[0], buffer.data(), buffer.size())) > 0) {
+      response.append(buffer.data(), n);
+    }
+    server.join();
+    close(fds[0]);
+    std::vector<std::string> lines;
+    std::istringstream is{response};
+    for (std::string line; std::getline(is, line);) {
+      lines.push_back(line);
+    }
+    return lines;
+  };
+
+  SECTION("CSV, until shutdown") {
+    const auto lines = exchange(
+        "csv 42\n8.8.8.8,24000,33434,2,icmp\n8.8.8.8,24000,33434,3,icmp\n",
+        true);
+    REQUIRE(lines.size() == 3);
+    REQUIRE(lines[0] == Reply::csv_header());
+    REQUIRE(lines[1].ends_with(",42"));
+    REQUIRE(lines[2].find("8.8.8.8") != std::string::npos);
+  }
+
+  SECTION("CSV, until empty line") {
+    const auto lines =
+        exchange("csv 42\n8.8.8.8,24000,33434,2,icmp\n\n", false);
+    REQUIRE(lines.size() == 2);
+  }
+
+  SECTION("Binary") {
+    std::string request = "binary 43 3\n";
+    std::array<std::byte, Probe::binary_size> buffer{};
+    for (uint8_t ttl = 1; ttl <= 3; ttl++) {
+      auto probe = Probe::from_csv("8.8.8.8,24000,33434,2,icmp");
+      probe.ttl = ttl;
+      probe.to_binary(buffer.data());
+      request.append(reinterpret_cast<const char*>(buffer.data()),
+                     buffer.size());
+    }
+    // With a count, the round ends without shutting down the connection.
+    auto lines = exchange(request, false);
+    REQUIRE(lines.size() == 4);
+    REQUIRE(lines[3].ends_with(",43"));
+    // Without, it ends at the shutdown.
+    request.replace(0, request.find('\n'), "binary 43");
+    lines = exchange(request, true);
+    REQUIRE(lines.size() == 4);
+  }
+
+  SECTION("Client not sending") {
+    int fds[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    caracal::Prober::serve_connection(fds[1], run,
+                                      std::chrono::milliseconds{100});
+    close(fds[1]);
+    std::array<char, 4096> buffer{};
+    REQUIRE(read(fds[0], buffer.data(), buffer.size()) > 0);
+    REQUIRE(std::string{buffer.data()}.starts_with("error:"));
+    close(fds[0]);
+  }
+
+  SECTION("Client not reading") {
+    // Much more replies than the socket buffers can hold.
+    replies_per_probe = 100'000;
+    int fds[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    const std::string request = "csv 42\n8.8.8.8,24000,33434,2,icmp\n\n";
+    REQUIRE(write(fds[0], request.data(), request.size()) ==
+            static_cast<ssize_t>(request.size()));
+    const auto start = std::chrono::steady_clock::now();
+    caracal::Prober::serve_connection(fds[1], run,
+                                      std::chrono::milliseconds{100});
+    REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds{5});
+    close(fds[1]);
+    close(fds[0]);
+  }
+
+  SECTION("Invalid header") {
+    for (const auto& header : {"pcap 42\n", "csv\n", "csv 42 3\n"}) {
+      const auto lines = exchange(header, true);
+      REQUIRE(lines.size() == 1);
+      REQUIRE(lines[0].starts_with("error:"));
+    }
+  }
+}
+
+TEST_CASE("Prober::Session/probe log") {
+  std::ofstream ofs;
+  ofs.open("zzz_input.csv");
+  for (int ttl = 1; ttl <= 32; ttl++) {
+    ofs << "8.8.8.8,24000,33434," << ttl << ",icmp\n";
+  }
+  ofs.close();
+  fs::remove("zzz_probes.bin");
+
+  // Every probe sent is logged, with or without its kernel timestamp.
+  const bool tx_timestamps = GENERATE(false, true);
+  Config config;
+  config.set_probing_rate(1000);
+  config.set_sniffer_wait_time(1);
+  config.set_tx_timestamps(tx_timestamps);
+  config.set_output_probes("zzz_probes.bin");
+
+  uint64_t sent = 0;
+  {
+    caracal::Prober::Session session{config, nullptr};
+    auto is = std::ifstream{"zzz_input.csv"};
+    auto [prober_stats, sniffer_stats, pcap_stats] = session.run(is, "1");
+    sent = prober_stats.sent;
+    REQUIRE(prober_stats.tx_timestamps_missing <= sent);
+  }
+  REQUIRE(sent == 32);
+  REQUIRE(fs::file_size("zzz_probes.bin") ==
+          sent * caracal::ProbeLog::Record::binary_size);
+
+  fs::remove("zzz_input.csv");
+  fs::remove("zzz_probes.bin");
+}
@@ -5,6 +5,7 @@
 
 using caracal::Protocols::L3;
 using caracal::Protocols::L4;
+using caracal::Protocols::l4_from_posix;
 using caracal::Protocols::l4_from_string;
 using caracal::Protocols::posix_value;
 using caracal::Protocols::to_string;
@@ -23,3 +24,10 @@ TEST_CASE("Protocols::posix_value") {
   REQUIRE(posix_value(L4::ICMPv6) == IPPROTO_ICMPV6);
   REQUIRE(posix_value(L4::UDP) == IPPROTO_UDP);
 }
+
+TEST_CASE("Protocols::l4_from_posix") {
+  REQUIRE(l4_from_posix(posix_value(L4::ICMP)) == L4::ICMP);
+  REQUIRE(l4_from_posix(posix_value(L4::ICMPv6)) == L4::ICMPv6);
+  REQUIRE(l4_from_posix(posix_value(L4::UDP)) == L4::UDP);
+  REQUIRE_THROWS_AS(l4_from_posix(IPPROTO_TCP), std::runtime_error);
+}
@@ -0,0 +1,172 @@
+#include <caracal/reparse.hpp>
+#include <caracal/reply.hpp>
+#include <caracal/reply_sink.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_string.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using caracal::CallbackSink;
+using caracal::Reply;
+using caracal::Reparse::CaptureFile;
+using caracal::Reparse::Options;
+using caracal::Reparse::reparse;
+
+static auto data = fs::path{__FILE__}.parent_path() / ".." / "data";
+
+namespace {
+
+template <typename T>
+void put(std::ostream &os, const T value) {
+  os.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+/// Write the frames of a capture file in pcapng format, with nanosecond
+/// timestamps.
+void write_pcapng(const CaptureFile &capture, const fs::path &path) {
+  std::ofstream ofs{path, std::ios::binary};
+  // Section header block.
+  put<uint32_t>(ofs, 0x0a0d0d0a);
+  put<uint32_t>(ofs, 28);
+  put<uint32_t>(ofs, 0x1a2b3c4d);
+  put<uint16_t>(ofs, 1);
+  put<uint16_t>(ofs, 0);
+  put<int64_t>(ofs, -1);
+  put<uint32_t>(ofs, 28);
+  // Interface description block, with if_tsresol = 9.
+  put<uint32_t>(ofs, 1);
+  put<uint32_t>(ofs, 32);
+  put<uint16_t>(ofs, static_cast<uint16_t>(capture.frames()[0].link_type));
+  put<uint16_t>(ofs, 0);
+  put<uint32_t>(ofs, 65535);
+  put<uint16_t>(ofs, 9);
+  put<uint16_t>(ofs, 1);
+  put<uint32_t>(ofs, 9);
+  put<uint32_t>(ofs, 0);
+  put<uint32_t>(ofs, 32);
+  for (const auto &frame : capture.frames()) {
+    const auto padding = (4 - frame.header.caplen % 4) % 4;
+    const auto length = 32 + frame.header.caplen + padding;
+    const auto ts = uint64_t(frame.header.ts.tv_sec) * 1'000'000'000 +
+                    uint64_t(frame.header.ts.tv_usec) * 1'000;
+    // Enhanced packet block.
+    put<uint32_t>(ofs, 6);
+    put<uint32_t>(ofs, length);
+    put<uint32_t>(ofs, 0);
+    put<uint32_t>(ofs, static_cast<uint32_t>(ts >> 32));
+    put<uint32_t>(ofs, static_cast<uint32_t>(ts));
+    put<uint32_t>(ofs, frame.header.caplen);
+    put<uint32_t>(ofs, frame.header.len);
+    ofs.write(reinterpret_cast<const char *>(frame.data), frame.header.caplen);
+    ofs.write("\0\0\0", padding);
+    put<uint32_t>(ofs, length);
+  }
+}
+
+std::vector<Reply> reparse_files(const std::vector<fs::path> &files,
+                                 const Options &options) {
+  std::vector<Reply> replies;
+  CallbackSink sink{[&](const Reply &reply, const std::string &) {
+    replies.push_back(reply);
+  }};
+  reparse(files, sink, options);
+  return replies;
+}
+
+}  // namespace
+
+TEST_CASE("Reparse::CaptureFile") {
+  const CaptureFile capture{data / "icmp-icmp-ttl-exceeded.pcap"};
+  const auto &frames = capture.frames();
+  REQUIRE(frames.size() == 2);
+  REQUIRE(frames[0].link_type == DLT_EN10MB);
+  REQUIRE(frames[0].header.caplen == 50);
+  REQUIRE(frames[1].header.caplen == 70);
+  REQUIRE(frames[1].header.ts.tv_sec == 1613155623);
+  REQUIRE(frames[1].header.ts.tv_usec == 845580);
+
+  SECTION("pcapng") {
+    write_pcapng(capture, "zzz_capture.pcapng");
+    const CaptureFile pcapng{"zzz_capture.pcapng"};
+    REQUIRE(pcapng.frames().size() == frames.size());
+    for (size_t i = 0; i < frames.size(); i++) {
+      const auto &frame = pcapng.frames()[i];
+      REQUIRE(frame.link_type == frames[i].link_type);
+      REQUIRE(frame.header.caplen == frames[i].header.caplen);
+      REQUIRE(frame.header.len == frames[i].header.len);
+      REQUIRE(frame.header.ts.tv_sec == frames[i].header.ts.tv_sec);
+      REQUIRE(frame.header.ts.tv_usec == frames[i].header.ts.tv_usec);
+      REQUIRE(std::equal(frame.data, frame.data + frame.header.caplen,
+                         frames[i].data));
+    }
+    fs::remove("zzz_capture.pcapng");
+  }
+
+  SECTION("Truncated") {
+    fs::copy_file(data / "icmp-icmp-ttl-exceeded.pcap", "zzz_capture.pcap");
+    fs::resize_file("zzz_capture.pcap", 150);
+    const CaptureFile truncated{"zzz_capture.pcap"};
+    REQUIRE(truncated.frames().size() == 1);
+    fs::remove("zzz_capture.pcap");
+  }
+
+  SECTION("Invalid") {
+    REQUIRE_THROWS_AS(CaptureFile{data / "icmp-icmp-ttl-exceeded.txt"},
+                      std::invalid_argument);
+    // The magic number of a zstd frame, followed by garbage.
+    std::ofstream{"zzz_capture.pcap.zst", std::ios::binary}
+        << "\x28\xb5\x2f\xfd" << std::string(64, 'a');
+    REQUIRE_THROWS_WITH(CaptureFile{"zzz_capture.pcap.zst"},
+                        Catch::Matchers::ContainsSubstring("zstd"));
+    fs::remove("zzz_capture.pcap.zst");
+  }
+}
+
+TEST_CASE("Reparse::reparse") {
+  std::vector<fs::path> files;
+  for (int i = 0; i < 20; i++) {
+    for (const auto &file :
+         {"arp.pcap", "icmp-icmp-echo-reply.pcap",
+          "icmp-icmp-ttl-exceeded-mpls.pcap", "icmp-icmp-ttl-exceeded.pcap",
+          "icmp6-icmp6-echo-reply.pcap", "icmp6-icmp6-ttl-exceeded.pcap",
+          "udp-icmp-ttl-exceeded.pcap", "udp-icmp6-ttl-exceeded.pcap"}) {
+      files.push_back(data / file);
+    }
+  }
+
+  // The captures were made with another caracal ID.
+  Options sequential{};
+  sequential.integrity_check = false;
+  sequential.threads = 1;
+  const auto expected = reparse_files(files, sequential);
+  REQUIRE(expected.size() == 20 * 7);
+  REQUIRE(expected[2].capture_timestamp == 1613155623845580);
+
+  // One frame per range, parsed out of order.
+  Options parallel = sequential;
+  parallel.threads = 4;
+  parallel.range_size = 1;
+  const auto replies = reparse_files(files, parallel);
+  REQUIRE(replies.size() == expected.size());
+  for (size_t i = 0; i < replies.size(); i++) {
+    REQUIRE(replies[i].to_csv("1") == expected[i].to_csv("1"));
+  }
+
+  std::ostringstream csv;
+  const auto statistics = reparse(files, csv, "csv", parallel);
+  REQUIRE(statistics.received_count == 20 * 15);
+  REQUIRE(statistics.received_count - statistics.received_invalid_count ==
+          expected.size());
+  std::string expected_csv = Reply::csv_header() + "\n";
+  for (const auto &reply : expected) {
+    expected_csv += reply.to_csv("1") + "\n";
+  }
+  REQUIRE(csv.str() == expected_csv);
+}
@@ -0,0 +1,96 @@
+#include <caracal/reply.hpp>
+#include <caracal/reply_sink.hpp>
+#include <caracal/utilities.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using caracal::BinarySink;
+using caracal::CallbackSink;
+using caracal::CsvSink;
+using caracal::Reply;
+using caracal::SynchronizedSink;
+using caracal::Utilities::parse_addr;
+
+namespace {
+
+Reply make_reply() {
+  Reply reply{};
+  reply.capture_timestamp = 1613155623845580;
+  parse_addr("72.14.204.68", reply.reply_src_addr);
+  parse_addr("192.168.1.5", reply.reply_dst_addr);
+  parse_addr("8.8.8.8", reply.probe_dst_addr);
+  reply.reply_size = 56;
+  reply.reply_ttl = 250;
+  reply.reply_protocol = IPPROTO_ICMP;
+  reply.reply_icmp_type = 11;
+  reply.probe_id = 46837;
+  reply.probe_size = 36;
+  reply.probe_protocol = IPPROTO_ICMP;
+  reply.probe_src_port = 24000;
+  reply.probe_ttl = 6;
+  reply.quoted_ttl = 1;
+  reply.rtt = 66;
+  reply.reply_mpls_labels = {{16, 0, 0, 255}, {1048575, 7, 1, 1}};
+  return reply;
+}
+
+}  // namespace
+
+TEST_CASE("CsvSink") {
+  std::ostringstream os;
+  CsvSink sink{os};
+  sink.write(make_reply(), "42");
+  sink.flush();
+  REQUIRE(os.str() == Reply::csv_header() + "\n" +
+                          make_reply().to_csv("42") + "\n");
+}
+
+TEST_CASE("BinarySink") {
+  std::ostringstream os;
+  BinarySink sink{os};
+  sink.write(make_reply(), "42");
+  sink.write(make_reply(), "42");
+  sink.flush();
+  const auto data = os.str();
+  REQUIRE(data.size() == 2 * Reply::binary_size);
+
+  const auto reply = Reply::from_binary(
+      reinterpret_cast<const std::byte *>(data.data() + Reply::binary_size));
+  REQUIRE(reply.to_csv("42") == make_reply().to_csv("42"));
+  REQUIRE(reply.probe_id == 46837);
+  REQUIRE(reply.reply_mpls_labels == make_reply().reply_mpls_labels);
+}
+
+TEST_CASE("CallbackSink") {
+  std::vector<std::string> rounds;
+  CallbackSink sink{[&](const Reply &reply, const std::string &round) {
+    REQUIRE(reply.rtt == 66);
+    rounds.push_back(round);
+  }};
+  sink.write(make_reply(), "1");
+  sink.write(make_reply(), "2");
+  REQUIRE(rounds == std::vector<std::string>{"1", "2"});
+}
+
+TEST_CASE("SynchronizedSink") {
+  uint64_t count = 0;
+  auto inner = std::make_shared<CallbackSink>(
+      [&](const Reply &, const std::string &) { count++; });
+  SynchronizedSink sink{inner};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < 10000; j++) {
+        sink.write(make_reply(), "1");
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  REQUIRE(count == 40000);
+}
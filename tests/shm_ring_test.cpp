@@ -0,0 +1,68 @@
+#include <caracal/reply.hpp>
+#include <caracal/shm_ring.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <stdexcept>
+#include <system_error>
+
+using caracal::Reply;
+using caracal::ShmRingReader;
+using caracal::ShmRingSink;
+
+namespace {
+
+Reply make_reply(uint16_t probe_id) {
+  Reply reply{};
+  reply.probe_id = probe_id;
+  reply.probe_ttl = 6;
+  reply.rtt = 66;
+  reply.reply_mpls_labels = {{16, 0, 1, 255}};
+  return reply;
+}
+
+}  // namespace
+
+TEST_CASE("ShmRingSink") {
+  REQUIRE_THROWS_AS(ShmRingSink("/caracal-test-ring", 3),
+                    std::invalid_argument);
+  REQUIRE_THROWS_AS(ShmRingReader("/caracal-test-zzz"), std::system_error);
+
+  ShmRingSink sink{"/caracal-test-ring", 4};
+  // Records written before the reader attaches are not visible.
+  sink.write(make_reply(0), "1");
+
+  ShmRingReader reader1{"/caracal-test-ring"};
+  ShmRingReader reader2{"/caracal-test-ring"};
+  Reply reply{};
+  REQUIRE(reader1.sequence() == 1);
+  REQUIRE_FALSE(reader1.read(reply));
+
+  SECTION("Read") {
+    sink.write(make_reply(1), "1");
+    sink.write(make_reply(2), "1");
+    // Each reader sees every record.
+    for (auto reader : {&reader1, &reader2}) {
+      REQUIRE(reader->read(reply));
+      REQUIRE(reply.probe_id == 1);
+      REQUIRE(reply.reply_mpls_labels == make_reply(1).reply_mpls_labels);
+      REQUIRE(reader->read(reply));
+      REQUIRE(reply.probe_id == 2);
+      REQUIRE_FALSE(reader->read(reply));
+      REQUIRE(reader->sequence() == 3);
+      REQUIRE(reader->overruns() == 0);
+    }
+  }
+
+  SECTION("Overrun") {
+    for (uint16_t i = 1; i <= 10; i++) {
+      sink.write(make_reply(i), "1");
+    }
+    REQUIRE(sink.sequence() == 11);
+    // Only the last 4 records are available.
+    for (uint16_t i = 7; i <= 10; i++) {
+      REQUIRE(reader1.read(reply));
+      REQUIRE(reply.probe_id == i);
+    }
+    REQUIRE_FALSE(reader1.read(reply));
+    REQUIRE(reader1.overruns() == 6);
+  }
+}
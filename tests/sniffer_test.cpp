@@ -0,0 +1,143 @@
+#include <pcap/pcap.h>
+#include <tins/tins.h>
+
+#include <caracal/parser.hpp>
+#include <caracal/sniffer.hpp>
+#include <caracal/utilities.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <optional>
+#include <string>
+
+using caracal::capture_settings;
+using caracal::CaptureSettings;
+using caracal::SnifferFilter;
+using caracal::Utilities::parse_addr;
+
+namespace fs = std::filesystem;
+
+static auto data = fs::path{__FILE__}.parent_path() / ".." / "data";
+
+/// Number of packets of the file accepted by the filter.
+static uint64_t count_matches(const fs::path& file,
+                              const SnifferFilter& filter) {
+  char errbuf[PCAP_ERRBUF_SIZE] = {};
+  auto handle = pcap_open_offline(file.c_str(), errbuf);
+  REQUIRE(handle != nullptr);
+  bpf_program program{};
+  REQUIRE(pcap_compile(handle, &program, filter.to_string().c_str(), 1,
+                       PCAP_NETMASK_UNKNOWN) == 0);
+  uint64_t count = 0;
+  pcap_pkthdr* header = nullptr;
+  const u_char* packet = nullptr;
+  while (pcap_next_ex(handle, &header, &packet) == 1) {
+    if (pcap_offline_filter(&program, header, packet)) {
+      count++;
+    }
+  }
+  pcap_freecode(&program);
+  pcap_close(handle);
+  return count;
+}
+
+/// The first reply of the file.
+static caracal::Reply first_reply(const fs::path& file) {
+  Tins::FileSniffer sniffer{file.string()};
+  std::optional<caracal::Reply> reply;
+  sniffer.sniff_loop([&](Tins::Packet& packet) {
+    reply = caracal::Parser::parse(packet);
+    return !reply;
+  });
+  REQUIRE(reply);
+  return *reply;
+}
+
+/// The caracal ID for which the reply is valid.
+static uint16_t valid_caracal_id(const caracal::Reply& reply) {
+  for (uint32_t id = 0; id <= 0xFFFF; id++) {
+    if (reply.is_valid(id)) {
+      return static_cast<uint16_t>(id);
+    }
+  }
+  FAIL("no valid caracal ID");
+  return 0;
+}
+
+TEST_CASE("SnifferFilter") {
+  const auto files = {"icmp-icmp-echo-reply.pcap",
+                      "icmp-icmp-ttl-exceeded.pcap",
+                      "icmp-icmp-ttl-exceeded-mpls.pcap",
+                      "icmp6-icmp6-echo-reply.pcap",
+                      "icmp6-icmp6-ttl-exceeded.pcap",
+                      "udp-icmp-ttl-exceeded.pcap",
+                      "udp-icmp6-ttl-exceeded.pcap"};
+
+  SECTION("Default") {
+    for (const auto& file : files) {
+      REQUIRE(count_matches(data / file, {}) == 1);
+    }
+    REQUIRE(count_matches(data / "arp.pcap", {}) == 0);
+  }
+
+  SECTION("Addresses") {
+    in6_addr other_v4{}, other_v6{};
+    parse_addr("192.0.2.1", other_v4);
+    parse_addr("2001:db8::1", other_v6);
+    for (const auto& file : files) {
+      const auto reply = first_reply(data / file);
+      REQUIRE(count_matches(data / file,
+                            {{reply.reply_dst_addr}, false, {}}) == 1);
+      REQUIRE(count_matches(data / file, {{other_v4, other_v6}, false, {}}) ==
+              0);
+    }
+  }
+
+  SECTION("Quoted protocols") {
+    for (const auto& file : files) {
+      REQUIRE(count_matches(data / file, {{}, true, {}}) == 1);
+    }
+  }
+
+  SECTION("Checksum") {
+    for (const auto& file :
+         {"icmp-icmp-ttl-exceeded.pcap", "icmp-icmp-ttl-exceeded-mpls.pcap",
+          "udp-icmp-ttl-exceeded.pcap"}) {
+      const auto id = valid_caracal_id(first_reply(data / file));
+      REQUIRE(count_matches(data / file, {{}, true, id}) == 1);
+      REQUIRE(count_matches(data / file,
+                            {{}, true, static_cast<uint16_t>(id + 1)}) == 0);
+    }
+    // Echo replies and IPv6 replies are not checked.
+    for (const auto& file :
+         {"icmp-icmp-echo-reply.pcap", "icmp6-icmp6-ttl-exceeded.pcap",
+          "udp-icmp6-ttl-exceeded.pcap"}) {
+      REQUIRE(count_matches(data / file, {{}, true, 1}) == 1);
+    }
+  }
+}
+
+TEST_CASE("capture_settings") {
+  SECTION("Low rate") {
+    const auto settings = capture_settings(100);
+    REQUIRE(settings.buffer_size == CaptureSettings::min_buffer_size);
+    REQUIRE(settings.immediate_mode);
+  }
+
+  SECTION("High rate") {
+    const auto settings = capture_settings(1'000'000);
+    REQUIRE(settings.buffer_size >= 1'000'000 * 2 * 256);
+    REQUIRE(settings.buffer_size % (1024 * 1024) == 0);
+    REQUIRE_FALSE(settings.immediate_mode);
+    REQUIRE(settings.timeout == 10);
+    REQUIRE(capture_settings(20'000).timeout == 50);
+    REQUIRE(capture_settings(100'000'000).buffer_size ==
+            CaptureSettings::max_buffer_size);
+  }
+
+  SECTION("Busy poll") {
+    const auto settings = capture_settings(100, 50);
+    REQUIRE_FALSE(settings.immediate_mode);
+    REQUIRE(settings.timeout == 1);
+    REQUIRE(settings.busy_poll == 50);
+  }
+}
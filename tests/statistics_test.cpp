@@ -1,7 +1,11 @@
 #include <caracal/statistics.hpp>
+#include <caracal/utilities.hpp>
 #include <catch2/catch_test_macros.hpp>
+#include <sstream>
 
 using caracal::Statistics::CircularArray;
+using caracal::Statistics::RttHistogram;
+using caracal::Utilities::parse_addr;
 
 TEST_CASE("CircularArray") {
   CircularArray<double, 4> a{};
@@ -25,3 +29,72 @@ TEST_CASE("CircularArray") {
     REQUIRE(a.average() == 1.75);
   }
 }
+
+TEST_CASE("RttHistogram") {
+  RttHistogram h{};
+  SECTION("Empty") {
+    REQUIRE(h.size() == 0);
+    REQUIRE(h.percentile(0.99) == 0);
+  }
+  SECTION("Base") {
+    // 99 replies at 1.5ms and one at 100ms.
+    for (auto i = 0; i < 99; i++) {
+      h.push_back(15);
+    }
+    h.push_back(1000);
+    REQUIRE(h.size() == 100);
+    REQUIRE(h.percentile(0.5) == 20);
+    REQUIRE(h.percentile(0.99) == 20);
+    REQUIRE(h.percentile(1.0) == 1010);
+  }
+  SECTION("Overflow") {
+    h.push_back(65535);
+    REQUIRE(h.percentile(0.99) == 65540);
+  }
+}
+
+TEST_CASE("Statistics::Sniffer") {
+  in6_addr a{}, b{};
+  parse_addr("192.0.2.1", a);
+  parse_addr("192.0.2.2", b);
+  caracal::Statistics::Sniffer s1{}, s2{};
+  s1.received_count = 2;
+  s1.icmp_messages_all.insert(a);
+  s2.received_count = 3;
+  s2.received_invalid_count = 1;
+  s2.icmp_messages_all.insert(a);
+  s2.icmp_messages_all.insert(b);
+  s2.icmp_messages_path.insert(b);
+  s1 += s2;
+  REQUIRE(s1.received_count == 5);
+  REQUIRE(s1.received_invalid_count == 1);
+  REQUIRE(s1.icmp_messages_all.size() == 2);
+  REQUIRE(s1.icmp_messages_path.size() == 1);
+
+  SECTION("Counters") {
+    caracal::Reply reply{};
+    reply.reply_src_addr = a;
+    reply.reply_protocol = IPPROTO_ICMP;
+    reply.reply_icmp_type = 11;
+    reply.probe_protocol = IPPROTO_UDP;
+    reply.probe_ttl = 5;
+    s1.observe(reply);
+    s2 = s1;
+    reply.reply_protocol = IPPROTO_ICMPV6;
+    reply.reply_icmp_type = 1;
+    reply.reply_icmp_code = 4;
+    reply.probe_protocol = IPPROTO_ICMPV6;
+    reply.probe_ttl = 255;
+    s2.observe(reply);
+    s1 += s2;
+    REQUIRE(s1.replies_by_ttl[2 * 256 + 5] == 2);
+    REQUIRE(s1.replies_by_ttl[1 * 256 + 255] == 1);
+    REQUIRE(s1.replies_by_icmp[11 * 16] == 2);
+    REQUIRE(s1.replies_by_icmp[256 * 16 + 1 * 16 + 4] == 1);
+    std::ostringstream os;
+    os << s1;
+    REQUIRE(os.str().ends_with(
+        " replies_by_ttl=icmp6/255:1,udp/5:2"
+        " replies_by_icmp=icmp/11/0:2,icmp6/1/4:1"));
+  }
+}
@@ -2,6 +2,9 @@
 
 #include <caracal/utilities.hpp>
 #include <catch2/catch_test_macros.hpp>
+#include <optional>
+#include <sstream>
+#include <string>
 
 using caracal::Utilities::format_addr;
 using caracal::Utilities::parse_addr;
@@ -24,3 +27,37 @@ TEST_CASE("Utilities::parse_addr") {
   REQUIRE_THROWS(parse_addr("8.8.4.4.0"));
   REQUIRE_THROWS(parse_addr("2001:4860:4860::8888::0000"));
 }
+
+TEST_CASE("Utilities::default_gateway_ipv6") {
+  using caracal::Utilities::default_gateway_ipv6;
+  // clang-format off
+  std::istringstream routes{
+      // Non-default route with a gateway.
+      "2001067c215400000000000000000000 30 00000000000000000000000000000000 00 fe800000000000000000000000000001 00000100 00000001 00000000 00000003     eth0\n"
+      // Default route without a gateway.
+      "00000000000000000000000000000000 00 00000000000000000000000000000000 00 00000000000000000000000000000000 00000400 00000001 00000000 00000001     eth0\n"
+      // Default routes through eth0, the second one has the lowest metric.
+      "00000000000000000000000000000000 00 00000000000000000000000000000000 00 fe800000000000000000000000000002 00000400 00000001 00000000 00000003     eth0\n"
+      "00000000000000000000000000000000 00 00000000000000000000000000000000 00 fe800000000000000000000000000003 00000064 00000001 00000000 00000003     eth0\n"
+      // Default route through another device, with a lower metric.
+      "00000000000000000000000000000000 00 00000000000000000000000000000000 00 fe800000000000000000000000000004 00000001 00000001 00000000 00000003    wlan0\n"};
+  // clang-format on
+  const auto text = routes.str();
+
+  auto gateway = default_gateway_ipv6(routes, "eth0");
+  REQUIRE(gateway);
+  REQUIRE(format_addr(*gateway) == "fe80::3");
+
+  routes.str(text);
+  routes.clear();
+  gateway = default_gateway_ipv6(routes, "wlan0");
+  REQUIRE(gateway);
+  REQUIRE(format_addr(*gateway) == "fe80::4");
+
+  routes.str(text);
+  routes.clear();
+  REQUIRE_FALSE(default_gateway_ipv6(routes, "eth1"));
+
+  std::istringstream empty;
+  REQUIRE_FALSE(default_gateway_ipv6(empty, "eth0"));
+}